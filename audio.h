@@ -28,6 +28,8 @@
 #ifndef _AUDIO_H_INCLUDED__
 #define _AUDIO_H_INCLUDED__
 
+#include <stddef.h>
+
 #include "my_types.h"
 
 #if defined(__cplusplus)
@@ -50,6 +52,12 @@ extern "C" {
 #define SYSTEM_PAL                  1
 #define SYSTEM_MPAL                 2
 
+/*
+ * file formats for the optional sound capture extension (CaptureAudio)
+ */
+#define AUDIO_CAPTURE_WAV           0
+#define AUDIO_CAPTURE_FLAC          1
+
 /* old names from the original specification file */
 #define hInst               hinst
 #define MemorySwapped       MemoryBswaped
@@ -70,6 +78,19 @@ extern "C" {
 #define GET_RCP_REG(member)     (*(AUDIO_INFO_NAME).member)
 #endif
 
+/*
+ * For plugins able to run more than one instance per process (see
+ * CreateAudio), each instance keeps its own AUDIO_INFO instead of the single
+ * global above.  Given a pointer to that instance's AUDIO_INFO, these macros
+ * work the same way:
+ * `GET_RCP_REG_CTX(info, MI_INTR_REG) |= MI_INTR_MASK_AI;'
+ */
+#define GET_AI_INFO_CTX(info, member)     ((info)->member)
+#define GET_RCP_REG_CTX(info, member)     (*(info)->member)
+
+/* opaque handle to one plugin instance, from CreateAudio */
+typedef p_void                  AUDIO_CONTEXT;
+
 /***** structures *****/
 
 typedef struct {
@@ -83,6 +104,65 @@ typedef struct {
                            native hardware's endian over the MIPS target's */
 } PLUGIN_INFO;
 
+/*
+ * optional features reported by GetDllCapabilities
+ *
+ * The emulator sets `Size' to the size of the structure it was built with and
+ * zeroes the rest; the plugin fills in only the members which fit in `Size',
+ * so that either side may be built against a later, longer version of this
+ * structure.  Members are only ever appended, and CAPABILITIES_VERSION grows.
+ */
+#define CAPABILITIES_VERSION        1
+
+#define CAPS_THREADED           0x00000001UL /* does work on its own threads */
+#define CAPS_BATCHED            0x00000002UL /* has ProcessPifRam */
+#define CAPS_CONTEXTS           0x00000004UL /* has Create* and `Ex' exports */
+#define CAPS_SHARED_CACHE       0x00000008UL /* has InitiateCache (RSP, GFX) */
+#define CAPS_ASYNC_FENCE        0x00000010UL /* see below */
+
+/*
+ * CAPS_ASYNC_FENCE means that the plugin writes files on worker threads after
+ * the export requesting them has returned, so the emulator must wait on the
+ * matching fence before using a file or calling RomClosed:
+ * CaptureScreenPending with a nonzero `Wait' for CaptureScreen and
+ * CaptureScreenEvery (GFX), RecordVideo with a NULL file name for RecordVideo
+ * (GFX), and CaptureAudioStop for CaptureAudio (audio).  Without it, each file
+ * is complete as soon as the export writing it (or, for recordings, the export
+ * stopping it) returns.
+ */
+
+#define SIMD_SSE2               0x00000001UL
+#define SIMD_SSSE3              0x00000002UL
+#define SIMD_SSE4_1             0x00000004UL
+#define SIMD_AVX                0x00000008UL
+#define SIMD_AVX2               0x00000010UL
+#define SIMD_AVX512             0x00000020UL
+#define SIMD_NEON               0x00000100UL
+#define SIMD_ALTIVEC            0x00000200UL
+
+typedef struct {
+    uint16_t Size;      /* Set by the emulator to the size of this structure. */
+    uint16_t Version;   /* Set to CAPABILITIES_VERSION. */
+    uint32_t Flags;     /* any of the CAPS_* flags above */
+    uint32_t SIMD;      /* any of the SIMD_* flags above, for those in use */
+} PLUGIN_CAPABILITIES;
+
+/* returned by GetConfigValue for a key the plugin does not know */
+#define CONFIG_UNKNOWN_KEY          (-1)
+
+/*
+ * standard keys for GetConfigValue and SetConfigValue
+ *
+ * Values are text, as they would be written in a configuration file, and
+ * keys are not case-sensitive.  Numbers are written in decimal, with no sign
+ * or spaces, and Boolean settings as `0' or `1'.  Plugins may accept keys of
+ * their own, too.
+ */
+#define CONFIG_THREADS              "threads"       /* worker threads, 0=auto */
+#define CONFIG_CACHE_SIZE           "cache_size"    /* in KiB, 0 for default */
+#define CONFIG_RESAMPLER_QUALITY    "resampler_quality" /* 0 = fastest */
+#define CONFIG_HLE                  "hle"           /* 0 for LLE, 1 for HLE */
+
 typedef struct {
     p_void hWnd;
     p_void hInst;
@@ -112,6 +192,27 @@ typedef struct {
     p_func CheckInterrupts;
 } AUDIO_INFO;
 
+/*
+ * callbacks for an instance made by CreateAudio, replacing those in AUDIO_INFO
+ *
+ * CheckInterrupts in AUDIO_INFO takes no arguments, so with more than one
+ * console in the process the emulator could not tell whose interrupt to
+ * check.  This callback is instead passed the emulator's own `Context' for the
+ * console, unchanged, and the callback in AUDIO_INFO is ignored.
+ */
+typedef struct {
+    p_void Context; /* emulator-defined, passed back to every callback */
+
+    void (*CheckInterrupts)(p_void Context);
+} AUDIO_CALLBACKS;
+
+/*
+ * the write count of the page of RDRAM at `address', from the counters
+ * passed to SetRdramWriteCounters
+ */
+#define RDRAM_PAGE_WRITES(pages, shift, address) \
+    ((pages)[(uint32_t)(address) >> (shift)])
+
 /******************************************************************************
 * name     :  AiDacrateChanged
 * optional :  no
@@ -154,6 +255,35 @@ EXPORT uint32_t CALL AiReadLength(void);
 *******************************************************************************/
 EXPORT void CALL AiUpdate(int Wait);
 
+/******************************************************************************
+* name     :  CaptureAudio
+* optional :  yes
+* call time:  when the user or a test harness requests that the sound output
+*             from here on be archived to the file system
+* input    :  Directory:  a text string representing the file system path
+*             Format   :  either AUDIO_CAPTURE_WAV or AUDIO_CAPTURE_FLAC
+* output   :  whether capturing started:  zero if false, nonzero if true
+* notes    :  Samples are tapped from the AI_DRAM_ADDR_REG buffer at the time
+*             of AiLenChanged and copied into a pool of buffers allocated here,
+*             for a separate encoder thread to compress and write to disk.
+*             AiLenChanged must never allocate or wait on file I/O on behalf
+*             of this feature; if the pool is exhausted, samples are dropped
+*             and counted, for CaptureAudioStop to report.
+*******************************************************************************/
+EXPORT int CALL CaptureAudio(char * Directory, int Format);
+
+/******************************************************************************
+* name     :  CaptureAudioStop
+* optional :  yes (required if CaptureAudio is exported)
+* call time:  when the sound capture started by CaptureAudio should end
+* input    :  none
+* output   :  the number of sample frames (one sample per channel) dropped from
+*             the file since CaptureAudio, or zero if the capture is complete
+* notes    :  Blocks until the encoder thread has flushed and closed the file,
+*             so it should not be called from the emulation thread.
+*******************************************************************************/
+EXPORT uint32_t CALL CaptureAudioStop(void);
+
 /******************************************************************************
 * name     :  CloseDLL
 * optional :  no
@@ -163,6 +293,33 @@ EXPORT void CALL AiUpdate(int Wait);
 *******************************************************************************/
 EXPORT void CALL CloseDLL(void);
 
+/******************************************************************************
+* name     :  CreateAudio
+* optional :  yes
+* call time:  in place of InitiateAudio, once for each emulated console that is
+*             to run in this process
+*             (This function is never to be called from the emulation thread.)
+* input    :  Audio_Info:  a AUDIO_INFO structure for this console's RCP memory
+*                          map, copied into the new instance
+*             Callbacks :  a AUDIO_CALLBACKS structure for this console,
+*                          copied into the new instance and used in place of
+*                          the CheckInterrupts callback in Audio_Info
+* output   :  a handle to the new instance, or NULL if it could not be created
+* notes    :  The handle is passed first to the `Ex' variant of every other
+*             per-instance export (see below), for as long as it is alive.
+*******************************************************************************/
+EXPORT AUDIO_CONTEXT CALL CreateAudio(
+    AUDIO_INFO * Audio_Info, AUDIO_CALLBACKS * Callbacks);
+
+/******************************************************************************
+* name     :  DestroyAudio
+* optional :  yes (required if CreateAudio is exported)
+* call time:  when the emulated console owning the instance is shut down
+* input    :  a handle returned by CreateAudio
+* output   :  none
+*******************************************************************************/
+EXPORT void CALL DestroyAudio(AUDIO_CONTEXT Context);
+
 /******************************************************************************
 * name     :  DllAbout
 * optional :  yes
@@ -190,6 +347,33 @@ EXPORT void CALL DllConfig(p_void hParent);
 *******************************************************************************/
 EXPORT void CALL DllTest(p_void hParent);
 
+/******************************************************************************
+* name     :  GetConfigValue
+* optional :  yes
+* call time:  whenever the emulator wants to read a plugin setting, including
+*             on systems where there is no window to pass to DllConfig
+* input    :  Key   :  name of the setting, such as one of the CONFIG_* keys
+*             Value :  buffer to receive the setting as a terminated string,
+*                      or NULL if Length is zero
+*             Length:  size of the Value buffer in bytes, terminator included
+* output   :  CONFIG_UNKNOWN_KEY if the key is not known, else the length of
+*             the whole value, not counting the terminator
+* notes    :  As with snprintf, at most Length - 1 characters are copied, and
+*             a result not less than Length means the value was truncated;
+*             calling with a Length of zero just asks for the size needed.
+*******************************************************************************/
+EXPORT int CALL GetConfigValue(const char * Key, char * Value, size_t Length);
+
+/******************************************************************************
+* name     :  GetDllCapabilities
+* optional :  yes
+* call time:  after GetDllInfo, when the emulator decides which optional fast
+*             paths to enable for the plugin
+* input    :  a pointer to a PLUGIN_CAPABILITIES structure to be filled in
+* output   :  none
+*******************************************************************************/
+EXPORT void CALL GetDllCapabilities(PLUGIN_CAPABILITIES * Capabilities);
+
 /******************************************************************************
 * name     :  GetDllInfo
 * optional :  no
@@ -212,6 +396,20 @@ EXPORT void CALL GetDllInfo(PLUGIN_INFO * PluginInfo);
 *******************************************************************************/
 EXPORT int CALL InitiateAudio(AUDIO_INFO Audio_Info);
 
+/******************************************************************************
+* name     :  LoadConfigFile
+* optional :  yes
+* call time:  at any time before RomOpen, and again before later calls to
+*             RomOpen whenever the settings are to be reloaded
+* input    :  FileName:  path to an INI file of `key = value' lines, optionally
+*                        under `[section]' headers, or a TOML file of the same
+*                        flat form; each pair is applied as by SetConfigValue
+* output   :  nonzero if the file was read, zero if it could not be
+* notes    :  Settings which cannot change while a ROM is open take effect
+*             at the next RomOpen.
+*******************************************************************************/
+EXPORT int CALL LoadConfigFile(const char * FileName);
+
 /******************************************************************************
 * name     :  ProcessAList
 * optional :  no
@@ -234,6 +432,59 @@ EXPORT void CALL ProcessAList(void);
 *******************************************************************************/
 EXPORT void CALL RomClosed(void);
 
+/******************************************************************************
+* name     :  SetConfigValue
+* optional :  yes
+* call time:  whenever the emulator wants to change a plugin setting, including
+*             on systems where there is no window to pass to DllConfig
+* input    :  Key  :  name of the setting, such as one of the CONFIG_* keys
+*             Value:  the new setting as a terminated string
+* output   :  nonzero if the key is known and the value was accepted, else zero
+* notes    :  Settings which cannot change while a ROM is open take effect
+*             at the next RomOpen.
+*******************************************************************************/
+EXPORT int CALL SetConfigValue(const char * Key, const char * Value);
+
+/******************************************************************************
+* name     :  SetRdramWriteCounters
+* optional :  yes (see the notes)
+* call time:  after InitiateAudio and before the ROM starts running, when the
+*             emulator offers to count the writes to each page of RDRAM
+* input    :  Pages    :  one write counter per page of RDRAM, owned by the
+*                         emulator and valid until after RomClosed, or NULL
+*                         to stop
+*             PageShift:  log2 of the page size in bytes (e.g., 12 for 4 KiB)
+* output   :  none
+* notes    :  The plugin increments the counter of each page it writes, with
+*             RDRAM_PAGE_WRITES (wrapping around), for everything ProcessAList
+*             writes to RDRAM, before the call making the write returns.
+*             Without this export, the emulator cannot offer write counters to
+*             the graphics plugin (see SetRdramWriteCounters in the graphics
+*             plugin specifications).
+*******************************************************************************/
+EXPORT void CALL SetRdramWriteCounters(uint32_t * Pages, uint32_t PageShift);
+
+/*
+ * per-instance variants of the above exports, for plugins exporting
+ * CreateAudio
+ *
+ * Each takes the handle returned by CreateAudio, followed by the parameters
+ * of the export of the same name without the `Ex' suffix, and behaves the same
+ * but for that instance only.  Exports not listed here (e.g., DllConfig) are
+ * shared by every instance of the plugin in the process.
+ */
+EXPORT void CALL AiDacrateChangedEx(AUDIO_CONTEXT Context, int SystemType);
+EXPORT void CALL AiLenChangedEx(AUDIO_CONTEXT Context);
+EXPORT uint32_t CALL AiReadLengthEx(AUDIO_CONTEXT Context);
+EXPORT void CALL AiUpdateEx(AUDIO_CONTEXT Context, int Wait);
+EXPORT int CALL CaptureAudioEx(
+    AUDIO_CONTEXT Context, char * Directory, int Format);
+EXPORT uint32_t CALL CaptureAudioStopEx(AUDIO_CONTEXT Context);
+EXPORT void CALL ProcessAListEx(AUDIO_CONTEXT Context);
+EXPORT void CALL RomClosedEx(AUDIO_CONTEXT Context);
+EXPORT void CALL SetRdramWriteCountersEx(
+    AUDIO_CONTEXT Context, uint32_t * Pages, uint32_t PageShift);
+
 #if defined(__cplusplus)
 }
 #endif
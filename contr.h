@@ -68,6 +68,12 @@ extern "C" {
 /* original, typo'd macro name from original spec file */
 #define PLUGIN_TANSFER_PAK          4
 
+/* size of the PIF RAM block handed to ProcessPifRam, in bytes */
+#define PIF_RAM_SIZE                64
+
+/* size of a controller pak (mempak) image, in bytes */
+#define MEMPAK_SIZE                 0x8000
+
 /* probably supposed to delete below comment by zilmar, don't know yet */
 /******************************************************************************
 * Note about controller plugins:
@@ -91,6 +97,18 @@ extern "C" {
 #define GET_RCP_REG(member)     (*(CONTROL_INFO_NAME).member)
 #endif
 
+/*
+ * For plugins able to run more than one instance per process (see
+ * CreateControllers), each instance keeps its own CONTROL_INFO instead of the
+ * single global above.  Given a pointer to that instance's CONTROL_INFO, this
+ * macro works the same way:  `GET_SI_INFO_CTX(info, Controls)[0].Present'
+ * (CONTROL_INFO holds no RCP registers, so there is no GET_RCP_REG_CTX here.)
+ */
+#define GET_SI_INFO_CTX(info, member)     ((info)->member)
+
+/* opaque handle to one plugin instance, from CreateControllers */
+typedef p_void                  CONTROL_CONTEXT;
+
 /***** structures *****/
 
 typedef struct {
@@ -101,6 +119,63 @@ typedef struct {
     int Reserved2;
 } PLUGIN_INFO;
 
+/*
+ * optional features reported by GetDllCapabilities
+ *
+ * The emulator sets `Size' to the size of the structure it was built with and
+ * zeroes the rest; the plugin fills in only the members which fit in `Size',
+ * so that either side may be built against a later, longer version of this
+ * structure.  Members are only ever appended, and CAPABILITIES_VERSION grows.
+ */
+#define CAPABILITIES_VERSION        1
+
+#define CAPS_THREADED           0x00000001UL /* does work on its own threads */
+#define CAPS_BATCHED            0x00000002UL /* has ProcessPifRam */
+#define CAPS_CONTEXTS           0x00000004UL /* has Create* and `Ex' exports */
+#define CAPS_SHARED_CACHE       0x00000008UL /* has InitiateCache (RSP, GFX) */
+#define CAPS_ASYNC_FENCE        0x00000010UL /* see below */
+
+/*
+ * CAPS_ASYNC_FENCE means that the plugin writes files on worker threads after
+ * the export requesting them has returned, so the emulator must wait on the
+ * matching fence before using a file or calling RomClosed:
+ * CaptureScreenPending with a nonzero `Wait' for CaptureScreen and
+ * CaptureScreenEvery (GFX), RecordVideo with a NULL file name for RecordVideo
+ * (GFX), and CaptureAudioStop for CaptureAudio (audio).  Without it, each file
+ * is complete as soon as the export writing it (or, for recordings, the export
+ * stopping it) returns.
+ */
+
+#define SIMD_SSE2               0x00000001UL
+#define SIMD_SSSE3              0x00000002UL
+#define SIMD_SSE4_1             0x00000004UL
+#define SIMD_AVX                0x00000008UL
+#define SIMD_AVX2               0x00000010UL
+#define SIMD_AVX512             0x00000020UL
+#define SIMD_NEON               0x00000100UL
+#define SIMD_ALTIVEC            0x00000200UL
+
+typedef struct {
+    uint16_t Size;      /* Set by the emulator to the size of this structure. */
+    uint16_t Version;   /* Set to CAPABILITIES_VERSION. */
+    uint32_t Flags;     /* any of the CAPS_* flags above */
+    uint32_t SIMD;      /* any of the SIMD_* flags above, for those in use */
+} PLUGIN_CAPABILITIES;
+
+/* returned by GetConfigValue for a key the plugin does not know */
+#define CONFIG_UNKNOWN_KEY          (-1)
+
+/*
+ * standard keys for GetConfigValue and SetConfigValue
+ *
+ * Values are text, as they would be written in a configuration file, and
+ * keys are not case-sensitive.  Numbers are written in decimal, with no sign
+ * or spaces, and Boolean settings as `0' or `1'.  Plugins may accept keys of
+ * their own, too.
+ */
+#define CONFIG_THREADS              "threads"       /* worker threads, 0=auto */
+#define CONFIG_CACHE_SIZE           "cache_size"    /* in KiB, 0 for default */
+
 typedef struct {
     int Present; /* of Boolean significance:  plugged in? */
     int RawData; /* of Boolean significance:  low-level processing */
@@ -191,6 +266,85 @@ typedef union {
     OS_CONT_PAD cont_pad;
 } BUTTONS;
 
+/*
+ * optional shared-memory alternative to calling GetKeys on every poll
+ *
+ * The plugin owns this block and updates it from its own input thread,
+ * guarding it with a sequence lock, so that the emulator's PIF handling never
+ * needs a function call or a system call:
+ *     writer:  increment `Sequence' to an odd number, release fence,
+ *              store the `Keys', release fence,
+ *              increment `Sequence' to an even number
+ *     reader:  load `Sequence' (retry while odd), acquire fence,
+ *              load all four `Keys', acquire fence,
+ *              load `Sequence' again (retry unless unchanged)
+ *
+ * `volatile' alone orders nothing between threads, and without the fences a
+ * reader on a weakly ordered host (e.g., ARM) can accept torn `Keys'.  The
+ * members are plain 32-bit objects, not C11 `_Atomic' or std::atomic ones, so
+ * they must not be cast to those types.  Instead, with GCC or Clang, each
+ * load and store is __atomic_load_n or __atomic_store_n with __ATOMIC_RELAXED,
+ * and the fences are __atomic_thread_fence(__ATOMIC_RELEASE) and
+ * __atomic_thread_fence(__ATOMIC_ACQUIRE).  With Microsoft's compiler, each
+ * access is a plain `volatile' one (aligned 32-bit loads and stores never
+ * tear on Windows targets), and both fences are MemoryBarrier().
+ */
+typedef struct {
+    volatile uint32_t Sequence;
+    volatile uint32_t Keys[4]; /* BUTTONS.Value for each controller, 0 to 3 */
+} SHARED_KEYS;
+
+/*
+ * storage for controller paks, mapped into memory by the emulator
+ *
+ * The emulator maps each file (e.g., with mmap or MapViewOfFile) and keeps it
+ * mapped from before RomOpen until after RomClosed.  The plugin then reads
+ * and writes pak data in place and sets `Dirty' after any write, instead of
+ * rewriting the whole file on the emulation thread.  After RomClosed, the
+ * emulator flushes `Mempak' and `GB_SRAM' (e.g., with msync) if marked dirty
+ * and clears the flag.  Cartridge ROM is never written, may be mapped
+ * read-only, and is not covered by `Dirty'.  Any pointer may be NULL if that
+ * storage is not in use.
+ */
+typedef struct {
+    uint8_t * Mempak; /* MEMPAK_SIZE bytes of controller pak SRAM */
+
+    const uint8_t * GB_ROM; /* Game Boy cartridge ROM for the transfer pak */
+    size_t GB_ROM_Size;
+    uint8_t * GB_SRAM; /* Game Boy cartridge save RAM for the transfer pak */
+    size_t GB_SRAM_Size;
+
+    int Dirty; /* of Boolean significance:  Mempak or GB_SRAM written since
+                  the last flush? */
+} PAK_STORAGE;
+
+/*
+ * input movie file format, for replaying recorded input through PlayInputMovie
+ *
+ * The file begins with this header, stored in little-endian byte order, and
+ * is followed by one record per poll:  a little-endian `BUTTONS.Value' for
+ * each controller selected in `Controllers', in order of controller number.
+ * Records are fixed-size, so the plugin can memory-map the file and stream or
+ * seek through it with constant memory, however long the replay.  The same
+ * values answer raw "read controller" commands in ReadController.
+ *
+ * A poll is one PIF transaction which reads at least one of the recorded
+ * controllers, ending with the call to ReadController(-1, ...) or with the
+ * call to ProcessPifRam.  Every controller read during one poll, by GetKeys
+ * or raw command, is answered from the same record, however many controllers
+ * are read and in whatever order; PIF transactions reading none of them do
+ * not use up a record.
+ */
+#define INPUT_MOVIE_MAGIC           0x4D343652UL /* "R64M" when stored */
+#define INPUT_MOVIE_VERSION         1
+
+typedef struct {
+    uint32_t Magic;       /* Set to INPUT_MOVIE_MAGIC. */
+    uint32_t Version;     /* Set to INPUT_MOVIE_VERSION. */
+    uint32_t Controllers; /* bit mask of recorded controllers (1 << Control) */
+    uint32_t Polls;       /* number of records following this header */
+} INPUT_MOVIE_HEADER;
+
 /* old names from the original specification file */
 #define hInst               hinst
 #define MemorySwapped       MemoryBswaped
@@ -230,6 +384,32 @@ EXPORT void CALL CloseDLL(void);
 *******************************************************************************/
 EXPORT void CALL ControllerCommand(int Control, uint8_t * Command);
 
+/******************************************************************************
+* name     :  CreateControllers
+* optional :  yes
+* call time:  in place of InitiateControllers, once for each emulated console
+*             that is to run in this process
+* input    :  ControlInfo:  a CONTROL_INFO structure for this console's
+*                           controllers, copied into the new instance
+* output   :  a handle to the new instance, or NULL if it could not be created
+* notes    :  The handle is passed first to the `Ex' variant of every other
+*             per-instance export (see below), for as long as it is alive.
+*******************************************************************************/
+#if (SPECS_VERSION >= 0x0101)
+EXPORT CONTROL_CONTEXT CALL CreateControllers(CONTROL_INFO * ControlInfo);
+#endif
+
+/******************************************************************************
+* name     :  DestroyControllers
+* optional :  yes (required if CreateControllers is exported)
+* call time:  when the emulated console owning the instance is shut down
+* input    :  a handle returned by CreateControllers
+* output   :  none
+*******************************************************************************/
+#if (SPECS_VERSION >= 0x0101)
+EXPORT void CALL DestroyControllers(CONTROL_CONTEXT Context);
+#endif
+
 /******************************************************************************
 * name     :  DllAbout
 * optional :  yes
@@ -257,6 +437,33 @@ EXPORT void CALL DllConfig(p_void hParent);
 *******************************************************************************/
 EXPORT void CALL DllTest(p_void hParent);
 
+/******************************************************************************
+* name     :  GetConfigValue
+* optional :  yes
+* call time:  whenever the emulator wants to read a plugin setting, including
+*             on systems where there is no window to pass to DllConfig
+* input    :  Key   :  name of the setting, such as one of the CONFIG_* keys
+*             Value :  buffer to receive the setting as a terminated string,
+*                      or NULL if Length is zero
+*             Length:  size of the Value buffer in bytes, terminator included
+* output   :  CONFIG_UNKNOWN_KEY if the key is not known, else the length of
+*             the whole value, not counting the terminator
+* notes    :  As with snprintf, at most Length - 1 characters are copied, and
+*             a result not less than Length means the value was truncated;
+*             calling with a Length of zero just asks for the size needed.
+*******************************************************************************/
+EXPORT int CALL GetConfigValue(const char * Key, char * Value, size_t Length);
+
+/******************************************************************************
+* name     :  GetDllCapabilities
+* optional :  yes
+* call time:  after GetDllInfo, when the emulator decides which optional fast
+*             paths to enable for the plugin
+* input    :  a pointer to a PLUGIN_CAPABILITIES structure to be filled in
+* output   :  none
+*******************************************************************************/
+EXPORT void CALL GetDllCapabilities(PLUGIN_CAPABILITIES * Capabilities);
+
 /******************************************************************************
 * name     :  GetDllInfo
 * optional :  no
@@ -278,6 +485,24 @@ EXPORT void CALL GetDllInfo(PLUGIN_INFO * PluginInfo);
 *******************************************************************************/
 EXPORT void CALL GetKeys(int Control, BUTTONS * Keys);
 
+/******************************************************************************
+* name     :  GetSharedKeys
+* optional :  yes
+* call time:  after each RomOpen, when the emulator would rather read the
+*             controllers' states from memory than call GetKeys per poll
+* input    :  none
+* output   :  a pointer to a plugin-owned SHARED_KEYS block, valid until
+*             RomClosed, or NULL if the plugin cannot publish input this way
+* notes    :  Once a non-NULL pointer is returned, the plugin keeps the block
+*             current on its own, and the emulator no longer calls GetKeys
+*             until RomClosed.  The pointer must not be used after RomClosed;
+*             the emulator calls this function again after each RomOpen, and
+*             falls back to GetKeys for that ROM if it then returns NULL.
+*             NULL is always returned while an input movie is replaying (see
+*             PlayInputMovie).
+*******************************************************************************/
+EXPORT SHARED_KEYS * CALL GetSharedKeys(void);
+
 /******************************************************************************
 * name     :  InitiateControllers
 * optional :  no
@@ -303,6 +528,83 @@ EXPORT void CALL InitiateControllers(CONTROL_INFO ControlInfo); /* wrong? */
 EXPORT void CALL InitiateControllers(CONTROL_INFO * ControlInfo);
 #endif
 
+/******************************************************************************
+* name     :  InitiatePaks
+* optional :  yes
+* call time:  after InitiateControllers and before every RomOpen, when the
+*             emulator has mapped the storage for each controller's pak into
+*             memory for the ROM about to be opened
+* input    :  Paks:  array of 4 PAK_STORAGE structures, one per controller,
+*                    owned by the emulator and valid until after RomClosed
+* output   :  none
+* notes    :  A plugin exporting this function should not open pak files of
+*             its own for a controller whose PAK_STORAGE is in use.
+*             The pointers given here must not be used after RomClosed, since
+*             the emulator may unmap them then; the emulator calls this
+*             function again before each later RomOpen, with the storage
+*             (possibly mapped elsewhere) for the next ROM.
+*******************************************************************************/
+EXPORT void CALL InitiatePaks(PAK_STORAGE Paks[4]);
+
+/******************************************************************************
+* name     :  LoadConfigFile
+* optional :  yes
+* call time:  at any time before RomOpen, and again before later calls to
+*             RomOpen whenever the settings are to be reloaded
+* input    :  FileName:  path to an INI file of `key = value' lines, optionally
+*                        under `[section]' headers, or a TOML file of the same
+*                        flat form; each pair is applied as by SetConfigValue
+* output   :  nonzero if the file was read, zero if it could not be
+* notes    :  Settings which cannot change while a ROM is open take effect
+*             at the next RomOpen.
+*******************************************************************************/
+EXPORT int CALL LoadConfigFile(const char * FileName);
+
+/******************************************************************************
+* name     :  PlayInputMovie
+* optional :  yes
+* call time:  after InitiateControllers, when the controllers' states should
+*             come from a recorded input movie instead of live devices
+* input    :  FileName:  path to the input movie file, or NULL to stop replay
+* output   :  whether replay started:  zero if false, nonzero if true
+* notes    :  While replaying, the movie advances to the next record at the
+*             end of each poll (see INPUT_MOVIE_HEADER), so the emulator must
+*             call ReadController(-1, NULL) at the end of every PIF transaction
+*             during replay, even for controllers without RawData, unless it
+*             uses ProcessPifRam.
+*             Controllers outside the mask read as having no buttons held.
+*             Past the last record, the final record's values are repeated.
+*             Replay needs every poll to reach the plugin, so it cannot start
+*             while a SHARED_KEYS block from GetSharedKeys is in use:  this
+*             function fails between a non-NULL GetSharedKeys and RomClosed,
+*             and GetSharedKeys returns NULL while replay is on.  To replay
+*             from the start of a ROM, call this before its RomOpen.  After
+*             replay is stopped, the emulator keeps calling GetKeys until the
+*             next RomOpen.
+*******************************************************************************/
+EXPORT int CALL PlayInputMovie(char * FileName);
+
+/******************************************************************************
+* name     :  ProcessPifRam
+* optional :  yes
+* call time:  when the raw data in PIF RAM is ready for processing, in place of
+*             every ControllerCommand and ReadController call for that block
+* input    :  PifRam:  pointer to the whole PIF_RAM_SIZE-byte PIF RAM block
+* output   :  none
+* notes    :  This function is only needed if the plugin is allowing raw data.
+*             In a single pass, the plugin walks the command list for every
+*             channel whose controller has RawData set, including mempak
+*             reads and writes and their address and data CRCs, and writes
+*             the responses back into PifRam.  Channels without RawData are
+*             left for the emulator to process as before.
+*             PifRam is always in the MIPS target's (big-endian) byte order,
+*             whatever the MemorySwapped flag, since both the command layout
+*             and the mempak address and data CRCs depend on it.  The PIF
+*             control byte at offset 0x3F belongs to the emulator and must
+*             be left unchanged by the plugin.
+*******************************************************************************/
+EXPORT void CALL ProcessPifRam(uint8_t * PifRam);
+
 /******************************************************************************
 * name     :  ReadController
 * optional :  yes
@@ -333,6 +635,30 @@ EXPORT void CALL RomClosed(void);
 *******************************************************************************/
 EXPORT void CALL RomOpen(void);
 
+/******************************************************************************
+* name     :  SeekInputMovie
+* optional :  yes (required if PlayInputMovie is exported)
+* call time:  during replay and between PIF transactions, when the emulator
+*             needs the movie to resume at a specific poll (e.g., after
+*             loading a save state)
+* input    :  Poll:  zero-based index of the next record to be read
+* output   :  whether seeking succeeded:  zero if false, nonzero if true
+*******************************************************************************/
+EXPORT int CALL SeekInputMovie(uint32_t Poll);
+
+/******************************************************************************
+* name     :  SetConfigValue
+* optional :  yes
+* call time:  whenever the emulator wants to change a plugin setting, including
+*             on systems where there is no window to pass to DllConfig
+* input    :  Key  :  name of the setting, such as one of the CONFIG_* keys
+*             Value:  the new setting as a terminated string
+* output   :  nonzero if the key is known and the value was accepted, else zero
+* notes    :  Settings which cannot change while a ROM is open take effect
+*             at the next RomOpen.
+*******************************************************************************/
+EXPORT int CALL SetConfigValue(const char * Key, const char * Value);
+
 /******************************************************************************
 * name     :  WM_KeyDown
 * optional :  yes
@@ -355,6 +681,35 @@ EXPORT void CALL WM_KeyDown(size_t wParam, ssize_t lParam);
 *******************************************************************************/
 EXPORT void CALL WM_KeyUp(size_t wParam, ssize_t lParam);
 
+/*
+ * per-instance variants of the above exports, for plugins exporting
+ * CreateControllers
+ *
+ * Each takes the handle returned by CreateControllers, followed by the
+ * parameters of the export of the same name without the `Ex' suffix, and
+ * behaves the same but for that instance only.  Exports not listed here
+ * (e.g., DllConfig) are shared by every instance of the plugin in the process.
+ */
+#if (SPECS_VERSION >= 0x0101)
+EXPORT void CALL ControllerCommandEx(
+    CONTROL_CONTEXT Context, int Control, uint8_t * Command);
+EXPORT void CALL GetKeysEx(
+    CONTROL_CONTEXT Context, int Control, BUTTONS * Keys);
+EXPORT SHARED_KEYS * CALL GetSharedKeysEx(CONTROL_CONTEXT Context);
+EXPORT void CALL InitiatePaksEx(CONTROL_CONTEXT Context, PAK_STORAGE Paks[4]);
+EXPORT int CALL PlayInputMovieEx(CONTROL_CONTEXT Context, char * FileName);
+EXPORT void CALL ProcessPifRamEx(CONTROL_CONTEXT Context, uint8_t * PifRam);
+EXPORT void CALL ReadControllerEx(
+    CONTROL_CONTEXT Context, int Control, uint8_t * Command);
+EXPORT void CALL RomClosedEx(CONTROL_CONTEXT Context);
+EXPORT void CALL RomOpenEx(CONTROL_CONTEXT Context);
+EXPORT int CALL SeekInputMovieEx(CONTROL_CONTEXT Context, uint32_t Poll);
+EXPORT void CALL WM_KeyDownEx(
+    CONTROL_CONTEXT Context, size_t wParam, ssize_t lParam);
+EXPORT void CALL WM_KeyUpEx(
+    CONTROL_CONTEXT Context, size_t wParam, ssize_t lParam);
+#endif
+
 #if defined(__cplusplus)
 }
 #endif
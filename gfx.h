@@ -20,6 +20,8 @@
 #ifndef _GFX_H_INCLUDED__
 #define _GFX_H_INCLUDED__
 
+#include <stddef.h>
+
 #include "my_types.h"
 
 #if defined(__cplusplus)
@@ -52,6 +54,18 @@ extern "C" {
 #define GET_RCP_REG(member)     (*(GFX_INFO_NAME).member)
 #endif
 
+/*
+ * For plugins able to run more than one instance per process (see CreateGFX),
+ * each instance keeps its own GFX_INFO instead of the single global above.
+ * Given a pointer to that instance's GFX_INFO, these macros work the same way:
+ * `GET_RCP_REG_CTX(info, MI_INTR_REG) |= MI_INTR_MASK_VI;'
+ */
+#define GET_GFX_INFO_CTX(info, member)    ((info)->member)
+#define GET_RCP_REG_CTX(info, member)     (*(info)->member)
+
+/* opaque handle to one plugin instance, from CreateGFX */
+typedef p_void                  GFX_CONTEXT;
+
 /***** structures *****/
 
 typedef struct {
@@ -65,8 +79,84 @@ typedef struct {
                            native hardware's endian over the MIPS target's */
 } PLUGIN_INFO;
 
+/*
+ * optional features reported by GetDllCapabilities
+ *
+ * The emulator sets `Size' to the size of the structure it was built with and
+ * zeroes the rest; the plugin fills in only the members which fit in `Size',
+ * so that either side may be built against a later, longer version of this
+ * structure.  Members are only ever appended, and CAPABILITIES_VERSION grows.
+ */
+#define CAPABILITIES_VERSION        1
+
+#define CAPS_THREADED           0x00000001UL /* does work on its own threads */
+#define CAPS_BATCHED            0x00000002UL /* has ProcessPifRam */
+#define CAPS_CONTEXTS           0x00000004UL /* has Create* and `Ex' exports */
+#define CAPS_SHARED_CACHE       0x00000008UL /* has InitiateCache (RSP, GFX) */
+#define CAPS_ASYNC_FENCE        0x00000010UL /* see below */
+
+/*
+ * CAPS_ASYNC_FENCE means that the plugin writes files on worker threads after
+ * the export requesting them has returned, so the emulator must wait on the
+ * matching fence before using a file or calling RomClosed:
+ * CaptureScreenPending with a nonzero `Wait' for CaptureScreen and
+ * CaptureScreenEvery (GFX), RecordVideo with a NULL file name for RecordVideo
+ * (GFX), and CaptureAudioStop for CaptureAudio (audio).  Without it, each file
+ * is complete as soon as the export writing it (or, for recordings, the export
+ * stopping it) returns.
+ */
+
+#define SIMD_SSE2               0x00000001UL
+#define SIMD_SSSE3              0x00000002UL
+#define SIMD_SSE4_1             0x00000004UL
+#define SIMD_AVX                0x00000008UL
+#define SIMD_AVX2               0x00000010UL
+#define SIMD_AVX512             0x00000020UL
+#define SIMD_NEON               0x00000100UL
+#define SIMD_ALTIVEC            0x00000200UL
+
 typedef struct {
-    p_void hWnd;        /* render window */
+    uint16_t Size;      /* Set by the emulator to the size of this structure. */
+    uint16_t Version;   /* Set to CAPABILITIES_VERSION. */
+    uint32_t Flags;     /* any of the CAPS_* flags above */
+    uint32_t SIMD;      /* any of the SIMD_* flags above, for those in use */
+} PLUGIN_CAPABILITIES;
+
+/* returned by GetConfigValue for a key the plugin does not know */
+#define CONFIG_UNKNOWN_KEY          (-1)
+
+/*
+ * standard keys for GetConfigValue and SetConfigValue
+ *
+ * Values are text, as they would be written in a configuration file, and
+ * keys are not case-sensitive.  Numbers are written in decimal, with no sign
+ * or spaces, and Boolean settings as `0' or `1'.  Plugins may accept keys of
+ * their own, too.
+ */
+#define CONFIG_THREADS              "threads"       /* worker threads, 0=auto */
+#define CONFIG_CACHE_SIZE           "cache_size"    /* in KiB, 0 for default */
+#define CONFIG_HLE                  "hle"           /* 0 for LLE, 1 for HLE */
+#define CONFIG_FRAME_SKIP           "frame_skip"    /* see below */
+#define CONFIG_TARGET_FPS           "target_fps"    /* for FRAME_SKIP_AUTO */
+
+/*
+ * frame-skip, for runs where not every picture needs to be seen
+ *
+ * CONFIG_FRAME_SKIP is either a number N, for rendering one frame out of every
+ * N + 1, or FRAME_SKIP_AUTO, for skipping only as often as needed to keep up
+ * with CONFIG_TARGET_FPS pictures per second on the host.  A frame starts at
+ * the first UpdateScreen after VI_ORIGIN_REG changes, so the decision follows
+ * the game's own frame rate rather than the rate of vertical interrupts.
+ *
+ * In a skipped frame, ProcessDList and ProcessRDPList still have to make every
+ * change to RDRAM that the CPU may read back, such as depth buffers or color
+ * images later used as textures, and may only skip rasterizing the color
+ * image which VI_ORIGIN_REG will show next.
+ */
+#define FRAME_SKIP_AUTO             "auto"
+
+typedef struct {
+    p_void hWnd;        /* render window, or NULL (see GetFramebuffer) */
     p_void hStatusBar;  /* NULL if the render window has no status bar */
 
     int MemoryBswaped;
@@ -107,6 +197,334 @@ typedef struct {
     p_func CheckInterrupts;
 } GFX_INFO;
 
+/*
+ * callbacks for an instance made by CreateGFX, replacing those in GFX_INFO
+ *
+ * CheckInterrupts in GFX_INFO takes no arguments, so with more than one console
+ * in the process the emulator could not tell whose interrupt to check.  This
+ * callback is instead passed the emulator's own `Context' for the console,
+ * unchanged, and the callback in GFX_INFO is ignored.
+ */
+typedef struct {
+    p_void Context; /* emulator-defined, passed back to every callback */
+
+    void (*CheckInterrupts)(p_void Context);
+} GFX_CALLBACKS;
+
+/*
+ * fields of VI_STATUS_REG (VI_CONTROL_REG), which configure the filters the
+ * VI applies to the color image on its way out:  anti-aliasing and resampling,
+ * the divot filter, gamma correction with or without dither, and the dither
+ * filter.  These settings apply to whole frames, so a plugin can decode them
+ * once (e.g., in ViStatusChanged) and filter every scanline the same way.
+ */
+#define VI_STATUS_TYPE(status)          ((status) & 0x3U)
+#define VI_TYPE_BLANK                   0 /* no data, no sync */
+#define VI_TYPE_RESERVED                1
+#define VI_TYPE_16BIT                   2 /* 5/5/5/3 (RGBA with coverage) */
+#define VI_TYPE_32BIT                   3 /* 8/8/8/8 (RGBA) */
+
+#define VI_STATUS_GAMMA_DITHER          0x00000004UL
+#define VI_STATUS_GAMMA                 0x00000008UL
+#define VI_STATUS_DIVOT                 0x00000010UL
+#define VI_STATUS_SERRATE               0x00000040UL
+#define VI_STATUS_DITHER_FILTER         0x00010000UL
+
+#define VI_STATUS_AA_MODE(status)       (((status) >>  8) & 0x3U)
+#define VI_AA_RESAMPLE_ALWAYS           0 /* AA and resampling, extra lines */
+#define VI_AA_RESAMPLE                  1 /* AA and resampling */
+#define VI_AA_RESAMPLE_ONLY             2 /* resampling only */
+#define VI_AA_NONE                      3 /* neither (replicate pixels) */
+
+#define VI_STATUS_PIXEL_ADVANCE(status) (((status) >> 12) & 0xFU)
+
+/*
+ * bits of DPC_STATUS_REG as read, and as written to change them
+ *
+ * DPC_CLOCK_REG, DPC_BUFBUSY_REG, DPC_PIPEBUSY_REG and DPC_TMEM_REG are 24-bit
+ * counters of RDP clocks:  total, command buffer busy, pipeline busy and TMEM
+ * loading.  Writing a DPC_CLR_*_CTR bit to DPC_STATUS_REG resets a counter.
+ */
+#define DPC_STATUS_XBUS_DMEM_DMA        0x00000001UL
+#define DPC_STATUS_FREEZE               0x00000002UL
+#define DPC_STATUS_FLUSH                0x00000004UL
+#define DPC_STATUS_START_GCLK           0x00000008UL
+#define DPC_STATUS_TMEM_BUSY            0x00000010UL
+#define DPC_STATUS_PIPE_BUSY            0x00000020UL
+#define DPC_STATUS_CMD_BUSY             0x00000040UL
+#define DPC_STATUS_CBUF_READY           0x00000080UL
+#define DPC_STATUS_DMA_BUSY             0x00000100UL
+#define DPC_STATUS_END_VALID            0x00000200UL
+#define DPC_STATUS_START_VALID          0x00000400UL
+
+#define DPC_CLR_XBUS_DMEM_DMA           0x00000001UL
+#define DPC_SET_XBUS_DMEM_DMA           0x00000002UL
+#define DPC_CLR_FREEZE                  0x00000004UL
+#define DPC_SET_FREEZE                  0x00000008UL
+#define DPC_CLR_FLUSH                   0x00000010UL
+#define DPC_SET_FLUSH                   0x00000020UL
+#define DPC_CLR_TMEM_CTR                0x00000040UL
+#define DPC_CLR_PIPE_CTR                0x00000080UL
+#define DPC_CLR_CMD_CTR                 0x00000100UL
+#define DPC_CLR_CLOCK_CTR               0x00000200UL
+
+#define DPC_COUNTER_MASK                0x00FFFFFFUL
+#define DPC_COUNTER_ADD(reg, clocks)    \
+    ((reg) = ((reg) + (clocks)) & DPC_COUNTER_MASK)
+
+/*
+ * a cheap model of RDP timing, for keeping the above counters plausible
+ *
+ * Rather than simulate the pipeline, the plugin estimates the clocks each
+ * command takes and adds them in place with DPC_COUNTER_ADD:  to the clock
+ * and command buffer counters for every command, to the pipeline counter for
+ * every primitive and to the TMEM counter for every texture load.  Primitive
+ * costs follow the cycle type set by the last Set Other Modes command, with
+ * the fill rates below given in quarter-clocks per pixel.  Copy and fill
+ * modes write 64 bits per clock, so their rates depend on the pixel size of
+ * the color image; the copy rate is for 16-bit color images, the usual case.
+ */
+#define RDP_CYCLE_TYPE(w0)              (((w0) >> 20) & 0x3U)
+#define RDP_CYCLE_1CYCLE                0
+#define RDP_CYCLE_2CYCLE                1
+#define RDP_CYCLE_COPY                  2
+#define RDP_CYCLE_FILL                  3
+
+#define RDP_QCLOCKS_1CYCLE              4 /* 1 pixel per clock */
+#define RDP_QCLOCKS_2CYCLE              8 /* 1 pixel per 2 clocks */
+#define RDP_QCLOCKS_COPY                1 /* 4 pixels per clock, 16 bpp */
+#define RDP_QCLOCKS_FILL_16BIT          1 /* 4 pixels per clock, 16 bpp */
+#define RDP_QCLOCKS_FILL_32BIT          2 /* 2 pixels per clock, 32 bpp */
+
+#define RDP_CLOCKS_PER_COMMAND          4 /* fetch and setup, per command */
+#define RDP_CLOCKS_PER_TMEM_WORD        1 /* per 64 bits loaded into TMEM */
+
+#define RDP_PIXEL_CLOCKS(qclocks, pixels)   (((pixels) * (qclocks) + 3) / 4)
+
+/*
+ * RDP commands, as found between DPC_START_REG and DPC_END_REG for
+ * ProcessRDPList, which is also enough to synthesize command streams of any
+ * primitive class (e.g., for measuring fill rates)
+ *
+ * Every command is a whole number of 64-bit words, identified by the 6-bit
+ * command ID in the top byte of the first word.  Triangles are four words of
+ * edge coefficients, followed by optional blocks for shade, texture and depth
+ * coefficients, as selected by three bits of the ID.
+ */
+#define RDP_COMMAND_ID(w0)              (((w0) >> 24) & 0x3FU)
+
+#define RDP_TRIANGLE                    0x08
+#define RDP_TRIANGLE_ZBUFFER            0x01
+#define RDP_TRIANGLE_TEXTURE            0x02
+#define RDP_TRIANGLE_SHADE              0x04
+#define RDP_TRIANGLE_WORDS(id)          (4                                     \
+    + ((id) & RDP_TRIANGLE_SHADE    ? 8 : 0)                                   \
+    + ((id) & RDP_TRIANGLE_TEXTURE  ? 8 : 0)                                   \
+    + ((id) & RDP_TRIANGLE_ZBUFFER  ? 2 : 0))
+
+#define RDP_TEXTURE_RECTANGLE           0x24 /* 2 words */
+#define RDP_TEXTURE_RECTANGLE_FLIP      0x25 /* 2 words */
+#define RDP_SYNC_LOAD                   0x26
+#define RDP_SYNC_PIPE                   0x27
+#define RDP_SYNC_TILE                   0x28
+#define RDP_SYNC_FULL                   0x29
+#define RDP_SET_KEY_GB                  0x2A
+#define RDP_SET_KEY_R                   0x2B
+#define RDP_SET_CONVERT                 0x2C
+#define RDP_SET_SCISSOR                 0x2D
+#define RDP_SET_PRIM_DEPTH              0x2E
+#define RDP_SET_OTHER_MODES             0x2F
+#define RDP_LOAD_TLUT                   0x30
+#define RDP_SET_TILE_SIZE               0x32
+#define RDP_LOAD_BLOCK                  0x33
+#define RDP_LOAD_TILE                   0x34
+#define RDP_SET_TILE                    0x35
+#define RDP_FILL_RECTANGLE              0x36
+#define RDP_SET_FILL_COLOR              0x37
+#define RDP_SET_FOG_COLOR               0x38
+#define RDP_SET_BLEND_COLOR             0x39
+#define RDP_SET_PRIM_COLOR              0x3A
+#define RDP_SET_ENV_COLOR               0x3B
+#define RDP_SET_COMBINE                 0x3C
+#define RDP_SET_TEXTURE_IMAGE           0x3D
+#define RDP_SET_Z_IMAGE                 0x3E
+#define RDP_SET_COLOR_IMAGE             0x3F
+
+/*
+ * the plugin's own output image, when rendering offscreen (see GetFramebuffer)
+ *
+ * Pixels are 32 bits each, of four 8-bit components in the byte order given
+ * by the format's name.  Rows are `Stride' bytes apart, which may be more than
+ * four times the `Width'.
+ */
+#define FRAMEBUFFER_RGBA8888        0
+#define FRAMEBUFFER_BGRA8888        1
+
+typedef struct {
+    p_void Pixels;      /* first byte of the top row */
+    uint32_t Width;     /* in pixels */
+    uint32_t Height;    /* in rows */
+    uint32_t Stride;    /* in bytes, from the start of one row to the next */
+    uint32_t Format;    /* one of the FRAMEBUFFER_* formats */
+} GFX_FRAMEBUFFER;
+
+/*
+ * one GBI command of a display list, flattened for HLE (see DumpDList)
+ *
+ * A first pass over the display list follows every unconditional call and
+ * branch (G_DL) through RDRAM and appends each command it reaches to a linear
+ * buffer of these, in the order of execution, so that a second pass can
+ * execute (or batch) them without chasing pointers.  G_DL itself is recorded;
+ * G_ENDDL is not.  A G_DL which pushes the return address (a call) puts the
+ * commands it reaches one `Depth' deeper, while a G_DL which does not (a
+ * branch) keeps the current `Depth', since it replaces the current display
+ * list:  the G_ENDDL ending the branched-to list returns from the list which
+ * branched, to the depth of its caller.
+ *
+ * Conditional commands, whose outcome depends on transformed vertices that
+ * only the second pass computes (G_CULLDL and G_BRANCH_Z), end the buffer:
+ * the first pass records the command and stops.  The second pass evaluates
+ * it, and the first pass then resumes flattening from the address chosen,
+ * with the call stack it had when it stopped.
+ *
+ * The words are in host byte order.  Only those commands whose `w1' holds an
+ * RDRAM address have it resolved from a segmented to a physical address:
+ * G_VTX, G_MTX, G_MOVEMEM, G_DL, G_SETTIMG, G_SETZIMG, G_SETCIMG, and the
+ * G_RDPHALF_1 carrying a G_BRANCH_Z target.  Every other `w1' (for example,
+ * of G_MOVEWORD, including the segment base it sets, or of G_SETOTHERMODE_L
+ * and G_SETOTHERMODE_H) is left as read.  The first pass still applies each
+ * G_MOVEWORD segment change itself, so that later addresses resolve right.
+ */
+typedef struct {
+    uint32_t w0;        /* the command's high word, opcode in the top 8 bits */
+    uint32_t w1;        /* the command's low word */
+    uint32_t Address;   /* physical RDRAM address the command was read from */
+    uint32_t Depth;     /* display list call depth, 0 for the top level */
+} GBI_COMMAND;
+
+/*
+ * the GBI variant whose opcode numbers and command layouts a dumped display
+ * list uses (see DumpDList)
+ *
+ * The variants number commands such as G_VTX, G_MTX and G_ENDDL differently,
+ * so the opcodes in GBI_COMMAND cannot be decoded without knowing which one
+ * the microcode ran.  Plugins may report their own variants from GBI_USER up.
+ */
+#define GBI_UNKNOWN                 0
+#define GBI_F3D                     1 /* Fast3D */
+#define GBI_F3DEX                   2 /* F3DEX, F3DLX, F3DLP and L3DEX 1.x */
+#define GBI_F3DEX2                  3 /* F3DEX2, F3DZEX and L3DEX2 */
+#define GBI_S2DEX                   4 /* S2DEX 1.x */
+#define GBI_S2DEX2                  5
+#define GBI_USER                    0x100
+
+/*
+ * reading the vertices and matrices loaded by G_VTX and G_MTX out of RDRAM
+ *
+ * These assume the MemorySwapped layout of RDRAM, with each 32-bit word in
+ * the host's byte order, and account for it with the HES and BES macros.
+ *
+ * A G_MTX matrix is sixteen signed 16.16 fixed-point elements, stored as all
+ * sixteen integer halves followed by all sixteen fractional halves.  It is
+ * best decoded once, when G_MTX loads it, rather than once per vertex.
+ *
+ * A vertex is GBI_VTX_SIZE bytes:  s16 x, y, z, a u16 flag and s16 s, t, as
+ * six halfwords, then four bytes of color (or normal) and alpha.  G_VTX loads
+ * up to GBI_VTX_MAX of them, which is a whole number of batches for
+ * transforming GBI_VTX_LANES vertices at a time, structure-of-arrays.
+ */
+#define GBI_VTX_SIZE                16
+#define GBI_VTX_MAX                 32
+#define GBI_VTX_LANES               8
+
+#define GBI_MTX_FIXED(RDRAM, address, row, col) (                              \
+    (s32)*(s16 *)((RDRAM) + HES((address) + 2*(4*(row) + (col)) +  0)) * 65536 \
+  + (s32)*(u16 *)((RDRAM) + HES((address) + 2*(4*(row) + (col)) + 32)))
+#define GBI_VTX_HALF(RDRAM, address, i) \
+    (*(s16 *)((RDRAM) + HES((address) + 2*(i))))
+#define GBI_VTX_BYTE(RDRAM, address, i) \
+    (*(u8 *)((RDRAM) + BES((address) + 12 + (i))))
+
+/*
+ * the write count of the page of RDRAM at `address', from the counters
+ * passed to SetRdramWriteCounters
+ */
+#define RDRAM_PAGE_WRITES(pages, shift, address) \
+    ((pages)[(uint32_t)(address) >> (shift)])
+
+/*
+ * counters of the video recording started by RecordVideo
+ *
+ * Frames are dropped, never waited on, whenever the queue to the writer
+ * thread is full, so `FramesDropped' rising means the output is too slow.
+ */
+typedef struct {
+    uint32_t FramesQueued;  /* frames tapped at UpdateScreen and queued */
+    uint32_t FramesWritten; /* frames the writer thread has finished writing */
+    uint32_t FramesDropped; /* frames discarded because the queue was full */
+} VIDEO_RECORD_STATS;
+
+/*
+ * hash functions which HashScreen may report having used
+ */
+#define SCREEN_HASH_NONE            0 /* no picture to hash */
+#define SCREEN_HASH_XXH3_128        1 /* XXH3, 128-bit, seed 0 */
+
+/*
+ * the number of rows of the color image HashScreen covers:  the active video
+ * half-lines between the start and end fields of VI_V_START_REG, halved into
+ * lines, then scaled by the 2.10 fixed-point factor in VI_Y_SCALE_REG, or 0
+ * if the end field is not after the start field
+ */
+#define VI_V_START_FIELD(v_start)       (((v_start) >> 16) & 0x3FFU)
+#define VI_V_END_FIELD(v_start)         (((v_start) >>  0) & 0x3FFU)
+#define VI_HASH_ROWS(v_start, y_scale) (                                       \
+    (VI_V_END_FIELD(v_start) <= VI_V_START_FIELD(v_start)) ? 0 :               \
+    (VI_V_END_FIELD(v_start) - VI_V_START_FIELD(v_start)) / 2                  \
+  * ((y_scale) & 0xFFFU) / 1024)
+
+/*
+ * a process-wide cache of read-only data, shared by every plugin instance
+ *
+ * Entries are keyed by the kind of data and a 128-bit hash of the content
+ * they were derived from (e.g., the IMEM words of a recompiled block, or the
+ * TMEM and tile descriptor behind a decoded texture), so that any number of
+ * instances running the same ROM look up the same entry instead of each
+ * building its own.  The emulator implements these functions; Lookup is
+ * expected to be lock-free, and all of them may be called concurrently from
+ * any instance on any thread.
+ *
+ * Lookup and Insert both return a pointer to the first byte of an entry's
+ * data, holding one more reference to the entry, or NULL; Lookup also stores
+ * the data's size in bytes through `Size'.  Insert copies the data, and if an
+ * equal key was inserted first by another instance, returns that entry's data
+ * instead.  The data is never written to, and stays valid until the reference
+ * is given back by passing the same pointer to Release.
+ *
+ * An entry whose last reference is released stays in the cache, so that an
+ * instance started later can still find it; the emulator evicts only such
+ * unreferenced entries, and only when it needs the memory.  Lookup may always
+ * return NULL, in which case the plugin builds and inserts the data itself.
+ *
+ * CACHE_RSP_BLOCK data is copied into memory which is readable and executable
+ * (but not writable) by the time Insert returns.  Because every instance runs
+ * the same copy, the code must be position-independent and must not embed the
+ * address of anything belonging to one instance, such as its registers, its
+ * RSP_INFO or the memory that structure points to.  It reaches such state only
+ * through a pointer the plugin passes in each time it runs the block.
+ */
+#define CACHE_RSP_BLOCK             1 /* recompiled RSP code */
+#define CACHE_TEXTURE               2 /* decoded texture */
+
+typedef struct {
+    p_void (*Lookup)(
+        int Kind, uint64_t HashHigh, uint64_t HashLow, size_t * Size);
+    p_void (*Insert)(
+        int Kind, uint64_t HashHigh, uint64_t HashLow,
+        const void * Data, size_t Size);
+    void (*Release)(const void * Data);
+} CACHE_INFO;
+
 /******************************************************************************
 * name     :  CaptureScreen
 * optional :  yes
@@ -114,11 +532,49 @@ typedef struct {
 *             video picture to the file system
 * input    :  a text string representing the file system path for disk writes
 * output   :  none
+* notes    :  Plugins should only copy the picture into one of a pool of
+*             buffers here and leave the PNG encoding and file writes to a
+*             worker thread, since this may be called from the emulation
+*             thread.  A plugin whose CaptureScreen returns before the file
+*             is written must export CaptureScreenPending, so the emulator
+*             can tell when it is; without that export, the emulator assumes
+*             the file is written by the time CaptureScreen returns.
 *******************************************************************************/
 #if (SPECS_VERSION >= 0x0103)
 EXPORT void CALL CaptureScreen(char * Directory);
 #endif
 
+/******************************************************************************
+* name     :  CaptureScreenEvery
+* optional :  yes
+* call time:  when the user or a test harness requests that the video picture
+*             be written to the file system continuously from here on
+* input    :  Directory:  a text string representing the file system path
+*             Interval :  capture on every Nth call to UpdateScreen, counting
+*                         from the next, or 0 to stop capturing continuously
+* output   :  none
+* notes    :  Each capture is handled as if by CaptureScreen.  If the worker
+*             thread falls behind and the buffer pool is exhausted, captures
+*             are skipped rather than making UpdateScreen wait.
+*******************************************************************************/
+#if (SPECS_VERSION >= 0x0103)
+EXPORT void CALL CaptureScreenEvery(char * Directory, uint32_t Interval);
+#endif
+
+/******************************************************************************
+* name     :  CaptureScreenPending
+* optional :  yes (required if CaptureScreenEvery is exported, or if the
+*             CaptureScreen export returns before the file is written)
+* call time:  when the emulator needs to know whether captures are written
+*             (e.g., before comparing them, or before calling RomClosed)
+* input    :  If `Wait' is nonzero, then this function should not return until
+*             every capture requested so far has been written.
+* output   :  the number of captures still waiting to be written to disk
+*******************************************************************************/
+#if (SPECS_VERSION >= 0x0103)
+EXPORT uint32_t CALL CaptureScreenPending(int Wait);
+#endif
+
 /******************************************************************************
 * name     :  ChangeWindow
 * optional :  no
@@ -142,6 +598,33 @@ EXPORT void CALL ChangeWindow(void);
 *******************************************************************************/
 EXPORT void CALL CloseDLL(void);
 
+/******************************************************************************
+* name     :  CreateGFX
+* optional :  yes
+* call time:  in place of InitiateGFX, once for each emulated console that is
+*             to run in this process
+*             (This function is never to be called from the emulation thread.)
+* input    :  Gfx_Info:  a GFX_INFO structure for this console's RCP memory map
+*                        and render window, copied into the new instance
+*             Callbacks:  a GFX_CALLBACKS structure for this console, copied
+*                         into the new instance and used in place of the
+*                         CheckInterrupts callback in Gfx_Info
+* output   :  a handle to the new instance, or NULL if it could not be created
+* notes    :  The handle is passed first to the `Ex' variant of every other
+*             per-instance export (see below), for as long as it is alive.
+*******************************************************************************/
+EXPORT GFX_CONTEXT CALL CreateGFX(
+    GFX_INFO * Gfx_Info, GFX_CALLBACKS * Callbacks);
+
+/******************************************************************************
+* name     :  DestroyGFX
+* optional :  yes (required if CreateGFX is exported)
+* call time:  when the emulated console owning the instance is shut down
+* input    :  a handle returned by CreateGFX
+* output   :  none
+*******************************************************************************/
+EXPORT void CALL DestroyGFX(GFX_CONTEXT Context);
+
 /******************************************************************************
 * name     :  DllAbout
 * optional :  yes
@@ -178,6 +661,51 @@ EXPORT void CALL DllTest(p_void hParent);
 *******************************************************************************/
 EXPORT void CALL DrawScreen(void);
 
+/******************************************************************************
+* name     :  DumpDList
+* optional :  yes
+* call time:  after ProcessDList, when the emulator wants to profile or save
+*             the display list that was just processed
+* input    :  Commands:  array to receive the flattened display list
+*             Count   :  number of GBI_COMMAND structures the array can hold
+*             GBI     :  set to the GBI_* variant of the microcode which ran
+*                        the display list, for decoding the opcodes
+* output   :  the number of commands in the flattened display list, which may
+*             be more than `Count' (in which case only `Count' were copied)
+* notes    :  Where flattening stopped at a conditional command, the commands
+*             flattened after resuming follow it, so the dump is the whole
+*             display list as executed.
+*******************************************************************************/
+EXPORT uint32_t CALL DumpDList(
+    GBI_COMMAND * Commands, uint32_t Count, uint32_t * GBI);
+
+/******************************************************************************
+* name     :  GetConfigValue
+* optional :  yes
+* call time:  whenever the emulator wants to read a plugin setting, including
+*             on systems where there is no window to pass to DllConfig
+* input    :  Key   :  name of the setting, such as one of the CONFIG_* keys
+*             Value :  buffer to receive the setting as a terminated string,
+*                      or NULL if Length is zero
+*             Length:  size of the Value buffer in bytes, terminator included
+* output   :  CONFIG_UNKNOWN_KEY if the key is not known, else the length of
+*             the whole value, not counting the terminator
+* notes    :  As with snprintf, at most Length - 1 characters are copied, and
+*             a result not less than Length means the value was truncated;
+*             calling with a Length of zero just asks for the size needed.
+*******************************************************************************/
+EXPORT int CALL GetConfigValue(const char * Key, char * Value, size_t Length);
+
+/******************************************************************************
+* name     :  GetDllCapabilities
+* optional :  yes
+* call time:  after GetDllInfo, when the emulator decides which optional fast
+*             paths to enable for the plugin
+* input    :  a pointer to a PLUGIN_CAPABILITIES structure to be filled in
+* output   :  none
+*******************************************************************************/
+EXPORT void CALL GetDllCapabilities(PLUGIN_CAPABILITIES * Capabilities);
+
 /******************************************************************************
 * name     :  GetDllInfo
 * optional :  no
@@ -187,6 +715,64 @@ EXPORT void CALL DrawScreen(void);
 *******************************************************************************/
 EXPORT void CALL GetDllInfo(PLUGIN_INFO * PluginInfo);
 
+/******************************************************************************
+* name     :  GetFramebuffer
+* optional :  yes (but see the notes)
+* call time:  after UpdateScreen returns, when the emulator wants to read the
+*             picture the plugin just rendered without a window
+* input    :  a pointer to a GFX_FRAMEBUFFER structure to be filled in
+* output   :  whether a picture is available:  zero if false, nonzero if true
+* notes    :  The image stays in memory owned by the plugin and is only valid
+*             until the next call to UpdateScreen, ChangeWindow or RomClosed,
+*             so the emulator can read, encode or hash it without a copy.
+*             With no window, the plugin can also serve CaptureScreen from the
+*             same image, rather than reading pixels back from a device.
+*             Older plugins dereference hWnd without checking it, so the
+*             emulator must not pass a NULL hWnd to InitiateGFX or CreateGFX
+*             unless the plugin exports this function.
+*******************************************************************************/
+EXPORT int CALL GetFramebuffer(GFX_FRAMEBUFFER * Framebuffer);
+
+/******************************************************************************
+* name     :  HashScreen
+* optional :  yes
+* call time:  after UpdateScreen, when the emulator wants to verify the picture
+*             without capturing it (e.g., against a list of expected hashes)
+* input    :  Hash:  array of two 64-bit words to receive the hash, with the
+*                    high 64 bits in Hash[0] and the low 64 bits in Hash[1]
+* output   :  the SCREEN_HASH_* function used, or SCREEN_HASH_NONE if the VI
+*             was not showing anything to hash
+* notes    :  The hash covers the color image the VI is showing, straight
+*             from RDRAM, as one run of bytes:  VI_HASH_ROWS rows, starting at
+*             the address in the low 24 bits of VI_ORIGIN_REG, each row being
+*             (VI_WIDTH_REG & 0xFFF) pixels wide, whether or not all of them
+*             are displayed.  Pixels are 2 bytes for VI_TYPE_16BIT and 4 for
+*             VI_TYPE_32BIT, and the bytes are in the big-endian order of the
+*             MIPS target regardless of the MemorySwapped flag.  The result
+*             therefore depends on neither the host nor the plugin's renderer,
+*             only on emulated RDRAM and VI registers.
+*             SCREEN_HASH_NONE is returned if VI_STATUS_REG selects neither
+*             type, if the row count or width is zero (including when the end
+*             field of VI_V_START_REG is not after the start field), if the
+*             image would run past the end of RDRAM (origin + rows * width *
+*             pixel size greater than the RDRAM size), or if the frame shown
+*             was skipped under CONFIG_FRAME_SKIP (its color image was never
+*             rendered into RDRAM); hashing runs should turn frame-skip off.
+*******************************************************************************/
+EXPORT int CALL HashScreen(uint64_t Hash[2]);
+
+/******************************************************************************
+* name     :  InitiateCache
+* optional :  yes
+* call time:  after plugin load and before InitiateGFX, when the emulator offers
+*             a cache shared by every plugin instance in the process
+* input    :  a CACHE_INFO structure of functions implemented by the emulator
+* output   :  none
+* notes    :  Without this call, or if any member is NULL, the plugin keeps
+*             private caches per instance as before.
+*******************************************************************************/
+EXPORT void CALL InitiateCache(CACHE_INFO Cache_Info);
+
 /******************************************************************************
 * name     :  InitiateGFX
 * optional :  no
@@ -200,6 +786,20 @@ EXPORT void CALL GetDllInfo(PLUGIN_INFO * PluginInfo);
 *******************************************************************************/
 EXPORT int CALL InitiateGFX(GFX_INFO Gfx_Info);
 
+/******************************************************************************
+* name     :  LoadConfigFile
+* optional :  yes
+* call time:  at any time before RomOpen, and again before later calls to
+*             RomOpen whenever the settings are to be reloaded
+* input    :  FileName:  path to an INI file of `key = value' lines, optionally
+*                        under `[section]' headers, or a TOML file of the same
+*                        flat form; each pair is applied as by SetConfigValue
+* output   :  nonzero if the file was read, zero if it could not be
+* notes    :  Settings which cannot change while a ROM is open take effect
+*             at the next RomOpen.
+*******************************************************************************/
+EXPORT int CALL LoadConfigFile(const char * FileName);
+
 /******************************************************************************
 * name     :  MoveScreen
 * optional :  no
@@ -230,6 +830,42 @@ EXPORT void CALL ProcessDList(void);
 EXPORT void CALL ProcessRDPList(void);
 #endif
 
+/******************************************************************************
+* name     :  RecordVideo
+* optional :  yes
+* call time:  when the user or a test harness requests that every picture from
+*             here on be recorded, or that recording stop
+* input    :  FileName:  path to a file or named pipe (FIFO) to receive a
+*                        YUV4MPEG2 (Y4M) stream, or NULL to stop recording
+* output   :  whether the request succeeded:  zero if false, nonzero if true
+* notes    :  On each UpdateScreen, the picture is converted to YUV 4:2:0 and
+*             pushed on a lock-free queue; a writer thread empties the queue
+*             into the file, so that UpdateScreen never waits on the reader.
+*             Stopping blocks until the writer thread has closed the file.
+*             The stream header is written at the first UpdateScreen after
+*             recording starts, as `YUV4MPEG2 W<w> H<h> F<rate> Ip A1:1
+*             C420jpeg':  <w> and <h> are the size of that first picture,
+*             each rounded up to an even number, and <rate> is the VI's field
+*             rate, `50:1' if (VI_V_SYNC_REG & 0x3FF) is 625 half-lines or
+*             more (PAL) and `60000:1001' otherwise (NTSC and MPAL).  Every
+*             later picture is scaled to that size, whatever the VI resolution
+*             becomes, so the stream never has to be restarted.
+*             One frame is written per UpdateScreen, so that the stream keeps
+*             the VI's timing:  for a frame skipped under CONFIG_FRAME_SKIP,
+*             the previous frame is repeated.  Only frames dropped because the
+*             queue was full are missing from the stream.
+*******************************************************************************/
+EXPORT int CALL RecordVideo(char * FileName);
+
+/******************************************************************************
+* name     :  RecordVideoStats
+* optional :  yes (required if RecordVideo is exported)
+* call time:  at any time, to monitor the recording started by RecordVideo
+* input    :  a pointer to a VIDEO_RECORD_STATS structure to be filled in
+* output   :  none
+*******************************************************************************/
+EXPORT void CALL RecordVideoStats(VIDEO_RECORD_STATS * Stats);
+
 /******************************************************************************
 * name     :  RomClosed
 * optional :  no
@@ -248,6 +884,48 @@ EXPORT void CALL RomClosed(void);
 *******************************************************************************/
 EXPORT void CALL RomOpen(void);
 
+/******************************************************************************
+* name     :  SetConfigValue
+* optional :  yes
+* call time:  whenever the emulator wants to change a plugin setting, including
+*             on systems where there is no window to pass to DllConfig
+* input    :  Key  :  name of the setting, such as one of the CONFIG_* keys
+*             Value:  the new setting as a terminated string
+* output   :  nonzero if the key is known and the value was accepted, else zero
+* notes    :  Settings which cannot change while a ROM is open take effect
+*             at the next RomOpen.
+*******************************************************************************/
+EXPORT int CALL SetConfigValue(const char * Key, const char * Value);
+
+/******************************************************************************
+* name     :  SetRdramWriteCounters
+* optional :  yes
+* call time:  after InitiateGFX and before RomOpen, when the emulator offers to
+*             count the writes to each page of RDRAM
+* input    :  Pages    :  one write counter per page of RDRAM, owned by the
+*                         emulator and valid until after RomClosed, or NULL
+*                         to stop
+*             PageShift:  log2 of the page size in bytes (e.g., 12 for 4 KiB)
+* output   :  none
+* notes    :  Every writer of RDRAM increments a page's counter (wrapping
+*             around) for each write it makes to that page, before the call
+*             making the write returns:  the emulator for CPU stores, PI DMA
+*             from the cartridge, SI DMA from PIF RAM and any SP DMA it
+*             performs itself; the RSP plugin for the SP DMA it performs; the
+*             audio plugin for what ProcessAList writes; and the graphics
+*             plugin for its own writes (e.g., color and depth images).  The
+*             same counters are passed to each of those plugins, and the
+*             emulator passes them to none unless every plugin which writes
+*             RDRAM exports SetRdramWriteCounters.  Nobody ever clears or
+*             resets a counter.
+*             A cached result, such as the transformed and clipped vertices
+*             of a display list subtree drawn every frame, keeps a copy of
+*             the counter of every page it was derived from, and can be
+*             reused for as long as all of those counters are unchanged, no
+*             matter how many other results depend on the same pages.
+*******************************************************************************/
+EXPORT void CALL SetRdramWriteCounters(uint32_t * Pages, uint32_t PageShift);
+
 /******************************************************************************
 * name     :  ShowCFB
 * optional :  can't remember, need to test (It is, however, purposeless. :))
@@ -269,10 +947,28 @@ EXPORT void CALL ShowCFB(void);
 *******************************************************************************/
 EXPORT void CALL UpdateScreen(void);
 
+/******************************************************************************
+* name     :  ViChangeCounter
+* optional :  yes
+* call time:  after InitiateGFX and before RomOpen, when the emulator would
+*             rather count VI register changes than report each one by a call
+* input    :  Counter:  pointer to a counter owned by the emulator, which it
+*                       increments whenever it detects a new value for either
+*                       VI_STATUS_REG or VI_WIDTH_REG, and which stays valid
+*                       until after RomClosed
+* output   :  whether the plugin accepts:  zero if false, nonzero if true
+* notes    :  Once the plugin accepts, the emulator no longer calls
+*             ViStatusChanged or ViWidthChanged.  Instead, the plugin compares
+*             the counter with the value it last saw, at UpdateScreen time,
+*             and recomputes its VI output parameters only if it changed.
+*******************************************************************************/
+EXPORT int CALL ViChangeCounter(volatile uint32_t * Counter);
+
 /******************************************************************************
 * name     :  ViStatusChanged
 * optional :  no
-* call time:  when a new value for VI_CONTROL_REG (VI_STATUS_REG) is detected
+* call time:  when a new value for VI_CONTROL_REG (VI_STATUS_REG) is detected,
+*             unless the plugin has accepted a counter through ViChangeCounter
 * input    :  none
 * output   :  none
 *******************************************************************************/
@@ -281,12 +977,56 @@ EXPORT void CALL ViStatusChanged(void);
 /******************************************************************************
 * name     :  ViWidthChanged
 * optional :  no
-* call time:  when a new value for VI_H_VIDEO_REG (VI_WIDTH_REG) is detected
+* call time:  when a new value for VI_H_VIDEO_REG (VI_WIDTH_REG) is detected,
+*             unless the plugin has accepted a counter through ViChangeCounter
 * input    :  none
 * output   :  none
 *******************************************************************************/
 EXPORT void CALL ViWidthChanged(void);
 
+/*
+ * per-instance variants of the above exports, for plugins exporting CreateGFX
+ *
+ * Each takes the handle returned by CreateGFX, followed by the parameters of
+ * the export of the same name without the `Ex' suffix, and behaves the same
+ * but for that instance only.  Exports not listed here (e.g., DllConfig) are
+ * shared by every instance of the plugin in the process.
+ */
+#if (SPECS_VERSION >= 0x0103)
+EXPORT void CALL CaptureScreenEx(GFX_CONTEXT Context, char * Directory);
+EXPORT void CALL CaptureScreenEveryEx(
+    GFX_CONTEXT Context, char * Directory, uint32_t Interval);
+EXPORT uint32_t CALL CaptureScreenPendingEx(GFX_CONTEXT Context, int Wait);
+#endif
+EXPORT void CALL ChangeWindowEx(GFX_CONTEXT Context);
+EXPORT void CALL DrawScreenEx(GFX_CONTEXT Context);
+EXPORT uint32_t CALL DumpDListEx(
+    GFX_CONTEXT Context, GBI_COMMAND * Commands, uint32_t Count,
+    uint32_t * GBI);
+EXPORT int CALL GetFramebufferEx(
+    GFX_CONTEXT Context, GFX_FRAMEBUFFER * Framebuffer);
+EXPORT int CALL HashScreenEx(GFX_CONTEXT Context, uint64_t Hash[2]);
+EXPORT void CALL MoveScreenEx(GFX_CONTEXT Context, int xpos, int ypos);
+EXPORT void CALL ProcessDListEx(GFX_CONTEXT Context);
+#if (SPECS_VERSION == 0x0100) | (SPECS_VERSION >= 0x0103)
+EXPORT void CALL ProcessRDPListEx(GFX_CONTEXT Context);
+#endif
+EXPORT int CALL RecordVideoEx(GFX_CONTEXT Context, char * FileName);
+EXPORT void CALL RecordVideoStatsEx(
+    GFX_CONTEXT Context, VIDEO_RECORD_STATS * Stats);
+EXPORT void CALL RomClosedEx(GFX_CONTEXT Context);
+EXPORT void CALL RomOpenEx(GFX_CONTEXT Context);
+EXPORT void CALL SetRdramWriteCountersEx(
+    GFX_CONTEXT Context, uint32_t * Pages, uint32_t PageShift);
+#if (SPECS_VERSION >= 0x0103)
+EXPORT void CALL ShowCFBEx(GFX_CONTEXT Context);
+#endif
+EXPORT void CALL UpdateScreenEx(GFX_CONTEXT Context);
+EXPORT int CALL ViChangeCounterEx(
+    GFX_CONTEXT Context, volatile uint32_t * Counter);
+EXPORT void CALL ViStatusChangedEx(GFX_CONTEXT Context);
+EXPORT void CALL ViWidthChangedEx(GFX_CONTEXT Context);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -379,17 +379,27 @@ typedef void(*p_func)(void);
 #ifdef _MSC_VER
 #define INLINE      __inline
 #define NOINLINE    __declspec(noinline)
-#define ALIGNED     _declspec(align(16))
+#define ALIGNED_TO(n)   _declspec(align(n))
 #elif defined(__GNUC__)
 #define INLINE      inline
 #define NOINLINE    __attribute__((noinline))
-#define ALIGNED     __attribute__((aligned(16)))
+#define ALIGNED_TO(n)   __attribute__((aligned(n)))
 #else
 #define INLINE
 #define NOINLINE
-#define ALIGNED
+#define ALIGNED_TO(n)
 #endif
 
+/*
+ * ALIGNMENT is the default for ALIGNED and may be predefined, for example as
+ * 32 when building for 256-bit vector registers.  ALIGNED_TO(n) is for types
+ * which need some other specific alignment.
+ */
+#ifndef ALIGNMENT
+#define ALIGNMENT   16
+#endif
+#define ALIGNED     ALIGNED_TO(ALIGNMENT)
+
 /*
  * aliasing helpers
  * Strictly put, this may be unspecified behavior, but it's nice to have!
@@ -431,6 +441,61 @@ typedef union {
     s64 SW;
 } word_64;
 
+/*
+ * wide-lane aliasing helpers, for vector registers with no native integer
+ *
+ * The halfword lanes are named for the fraction of the whole they occupy, as
+ * above:  E[8] are the eighths of a 128-bit word (the eight 16-bit elements
+ * of an RSP vector register), and X[16] are the sixteenths of a 256-bit word.
+ * Declare them as `ALIGNED word_128 v;' to let compilers vectorize access.
+ */
+typedef union {
+    u8 B[16];
+    s8 SB[16];
+
+    i16 E[8];
+    u16 UE[8];
+    s16 SE[8];
+
+    i32 Q[4];
+    u32 UQ[4];
+    s32 SQ[4];
+
+    i64 H[2];
+    u64 UH[2];
+    s64 SH[2];
+} word_128;
+typedef union {
+    u8 B[32];
+    s8 SB[32];
+
+    i16 X[16];
+    u16 UX[16];
+    s16 SX[16];
+
+    i32 E[8];
+    u32 UE[8];
+    s32 SE[8];
+
+    i64 Q[4];
+    u64 UQ[4];
+    s64 SQ[4];
+
+    word_128 H[2];
+} word_256;
+
+/*
+ * 48-bit lanes, as in each element of the RSP vector unit's accumulator,
+ * stored as three 16-bit slices from the low (L) to the high (H) slice.
+ * Eight lanes are better kept as three 128-bit slices of eight lanes each,
+ * so that every slice is one vector register wide (see VACC in "rsp.h").
+ */
+typedef struct {
+    u16 L;
+    u16 M;
+    u16 H;
+} word_48;
+
 /*
  * helper macros for indexing memory in the above unions
  * EEP!  Currently concentrates mostly on 32-bit endianness.
@@ -484,4 +549,49 @@ typedef struct {
 } MIPS_type_J;
 #endif
 
+/*
+ * The order in which a compiler packs the above bit-fields is implementation-
+ * defined, and reading or writing them often compiles to slower sequences
+ * than just shifting and masking a 32-bit instruction word.  These macros
+ * decode the same fields from any `u32' instruction word, portably.
+ */
+#define MIPS_OPCODE(inst)       (((inst) >> 26) & 0x3FU)
+#define MIPS_RS(inst)           (((inst) >> 21) & 0x1FU)
+#define MIPS_RT(inst)           (((inst) >> 16) & 0x1FU)
+#define MIPS_RD(inst)           (((inst) >> 11) & 0x1FU)
+#define MIPS_SA(inst)           (((inst) >>  6) & 0x1FU)
+#define MIPS_FUNCTION(inst)     (((inst) >>  0) & 0x3FU)
+#define MIPS_IMMEDIATE(inst)    (((inst) >>  0) & 0xFFFFU)
+#define MIPS_TARGET(inst)       (((inst) >>  0) & 0x03FFFFFFUL)
+
+/*
+ * sign extension without relying on right shifts of negative integers
+ */
+#define MIPS_SIGN_EXTEND(field, bits) \
+    ((s32)((field) ^ (1UL << ((bits) - 1))) - (s32)(1UL << ((bits) - 1)))
+#define MIPS_OFFSET(inst)       MIPS_SIGN_EXTEND(MIPS_IMMEDIATE(inst), 16)
+
+/*
+ * RSP vector unit extensions to the MIPS encodings
+ *
+ * COP2 computational instructions (with the CO bit, bit 25, set) replace `rs'
+ * with a 4-bit element selector and rename `rt', `rd' and `sa' to the vector
+ * registers `vt', `vs' and `vd'.  LWC2 and SWC2 address a vector register in
+ * the `rt' position (RSP_VT) and take a 4-bit element number from bits 7
+ * through 10; their load/store type lives in the `rd' position, followed by
+ * a 7-bit offset.  The COP2 moves differ:  MFC2 and MTC2 keep the scalar GPR
+ * in `rt' and put the vector register in `rd' (RSP_VS), with the element in
+ * bits 7 through 10 (RSP_LS_ELEMENT), while CFC2 and CTC2 put the number of
+ * the control register (VCO, VCC or VCE) in `rd' and have no element field.
+ */
+#define RSP_VU_CO(inst)         (((inst) >> 25) & 0x1U)
+#define RSP_VU_ELEMENT(inst)    (((inst) >> 21) & 0xFU)
+#define RSP_VT(inst)            MIPS_RT(inst)
+#define RSP_VS(inst)            MIPS_RD(inst)
+#define RSP_VD(inst)            MIPS_SA(inst)
+
+#define RSP_LS_TYPE(inst)       MIPS_RD(inst)
+#define RSP_LS_ELEMENT(inst)    (((inst) >>  7) & 0xFU)
+#define RSP_LS_OFFSET(inst)     MIPS_SIGN_EXTEND((inst) & 0x7FU, 7)
+
 #endif
@@ -9,6 +9,8 @@
 #ifndef _RSP_H_INCLUDED__
 #define _RSP_H_INCLUDED__
 
+#include <stddef.h>
+
 #include "my_types.h"
 
 #if defined(__cplusplus)
@@ -44,6 +46,18 @@ extern "C" {
 #define GET_RCP_REG(member)     (*(RSP_INFO_NAME).member)
 #endif
 
+/*
+ * For plugins able to run more than one instance per process (see CreateRSP),
+ * each instance keeps its own RSP_INFO instead of the single global above.
+ * Given a pointer to that instance's RSP_INFO, these macros work the same way:
+ * `GET_RCP_REG_CTX(info, MI_INTR_REG) |= MI_INTR_MASK_SP;'
+ */
+#define GET_RSP_INFO_CTX(info, member)    ((info)->member)
+#define GET_RCP_REG_CTX(info, member)     (*(info)->member)
+
+/* opaque handle to one plugin instance, from CreateRSP */
+typedef p_void                  RSP_CONTEXT;
+
 typedef struct {
     i32 left;
     i32 top;
@@ -71,6 +85,113 @@ typedef struct {
                            native hardware's endian over the MIPS target's */
 } PLUGIN_INFO;
 
+/*
+ * optional features reported by GetDllCapabilities
+ *
+ * The emulator sets `Size' to the size of the structure it was built with and
+ * zeroes the rest; the plugin fills in only the members which fit in `Size',
+ * so that either side may be built against a later, longer version of this
+ * structure.  Members are only ever appended, and CAPABILITIES_VERSION grows.
+ */
+#define CAPABILITIES_VERSION        1
+
+#define CAPS_THREADED           0x00000001UL /* does work on its own threads */
+#define CAPS_BATCHED            0x00000002UL /* has ProcessPifRam */
+#define CAPS_CONTEXTS           0x00000004UL /* has Create* and `Ex' exports */
+#define CAPS_SHARED_CACHE       0x00000008UL /* has InitiateCache (RSP, GFX) */
+#define CAPS_ASYNC_FENCE        0x00000010UL /* see below */
+
+/*
+ * CAPS_ASYNC_FENCE means that the plugin writes files on worker threads after
+ * the export requesting them has returned, so the emulator must wait on the
+ * matching fence before using a file or calling RomClosed:
+ * CaptureScreenPending with a nonzero `Wait' for CaptureScreen and
+ * CaptureScreenEvery (GFX), RecordVideo with a NULL file name for RecordVideo
+ * (GFX), and CaptureAudioStop for CaptureAudio (audio).  Without it, each file
+ * is complete as soon as the export writing it (or, for recordings, the export
+ * stopping it) returns.
+ */
+
+#define SIMD_SSE2               0x00000001UL
+#define SIMD_SSSE3              0x00000002UL
+#define SIMD_SSE4_1             0x00000004UL
+#define SIMD_AVX                0x00000008UL
+#define SIMD_AVX2               0x00000010UL
+#define SIMD_AVX512             0x00000020UL
+#define SIMD_NEON               0x00000100UL
+#define SIMD_ALTIVEC            0x00000200UL
+
+typedef struct {
+    uint16_t Size;      /* Set by the emulator to the size of this structure. */
+    uint16_t Version;   /* Set to CAPABILITIES_VERSION. */
+    uint32_t Flags;     /* any of the CAPS_* flags above */
+    uint32_t SIMD;      /* any of the SIMD_* flags above, for those in use */
+} PLUGIN_CAPABILITIES;
+
+/* returned by GetConfigValue for a key the plugin does not know */
+#define CONFIG_UNKNOWN_KEY          (-1)
+
+/*
+ * standard keys for GetConfigValue and SetConfigValue
+ *
+ * Values are text, as they would be written in a configuration file, and
+ * keys are not case-sensitive.  Numbers are written in decimal, with no sign
+ * or spaces, and Boolean settings as `0' or `1'.  Plugins may accept keys of
+ * their own, too.
+ */
+#define CONFIG_THREADS              "threads"       /* worker threads, 0=auto */
+#define CONFIG_CACHE_SIZE           "cache_size"    /* in KiB, 0 for default */
+#define CONFIG_CPU_CORE             "cpu_core"      /* see below */
+#define CONFIG_HLE                  "hle"           /* 0 for LLE, 1 for HLE */
+
+/*
+ * CONFIG_CPU_CORE is the number of one of the *CPU macros at the end of this
+ * file, so `0' selects InterpreterCPU, `1' RecompilerCPU and `2' PredecodedCPU.
+ * CONFIG_HLE selects whether audio lists are passed to ProcessAList (`1') or
+ * run on the emulated RSP (`0'), like Default_AudioHle.
+ */
+
+/*
+ * the RSP vector unit's accumulator:  eight lanes of 48 bits each
+ *
+ * It is stored as three separate 8-lane slices, high (H), middle (M) and low
+ * (L), rather than as eight 48-bit lanes.  Each slice is then one vector
+ * register wide, so that plain loops over the eight lanes of the VMAC family,
+ * or of the clamping below, can be compiled into single SIMD sequences.
+ */
+typedef struct {
+    ALIGNED word_128 H;
+    ALIGNED word_128 M;
+    ALIGNED word_128 L;
+} VACC;
+
+/*
+ * sign-extended 48-bit value of accumulator lane `e', and its reverse
+ */
+#define VACC_LANE(acc, e) (                                                    \
+    (s64)(acc).H.SE[e] * 65536 * 65536                                         \
+  + (s64)(acc).M.UE[e] * 65536                                                 \
+  + (s64)(acc).L.UE[e])
+#define VACC_SET_LANE(acc, e, value) (                                         \
+    (acc).L.UE[e] = (u16)(((value) >>  0) & 0xFFFF),                          \
+    (acc).M.UE[e] = (u16)(((value) >> 16) & 0xFFFF),                          \
+    (acc).H.UE[e] = (u16)(((value) >> 32) & 0xFFFF))
+
+/*
+ * the clamping applied when reading the accumulator back into a register
+ *
+ * VACC_CLAMP_SIGNED is the high-and-middle slices clamped to signed 16 bits,
+ * as written by VMACF, VMADH, VMUDH and the like.  VACC_CLAMP_LOW selects the
+ * low slice in range or else 0x0000 or 0xFFFF by sign, as written by VMADN.
+ */
+#define VACC_HM(acc, e) ((s32)(acc).H.SE[e] * 65536 + (s32)(acc).M.UE[e])
+#define VACC_CLAMP_SIGNED(acc, e) (                                            \
+    (VACC_HM(acc, e) < -32768) ? -32768 :                                      \
+    (VACC_HM(acc, e) > +32767) ? +32767 : (s16)(acc).M.SE[e])
+#define VACC_CLAMP_LOW(acc, e) (                                               \
+    (VACC_HM(acc, e) < -32768) ? 0x0000 :                                      \
+    (VACC_HM(acc, e) > +32767) ? 0xFFFF : (acc).L.UE[e])
+
 typedef struct {
     p_void hInst;
     int MemorySwapped;
@@ -109,6 +230,66 @@ typedef struct {
     p_func ShowCFB;
 } RSP_INFO;
 
+/*
+ * callbacks for an instance made by CreateRSP, replacing those in RSP_INFO
+ *
+ * The p_func callbacks in RSP_INFO take no arguments, so with more than one
+ * console in the process the emulator could not tell whose interrupt to
+ * check, or which console's graphics or audio instance a task belongs to.
+ * These callbacks are instead passed the emulator's own `Context' for the
+ * console, unchanged, and the callbacks in RSP_INFO are ignored.
+ */
+typedef struct {
+    p_void Context; /* emulator-defined, passed back to every callback */
+
+    void (*CheckInterrupts)(p_void Context);
+    void (*ProcessDList)(p_void Context);
+    void (*ProcessAList)(p_void Context);
+    void (*ProcessRdpList)(p_void Context);
+    void (*ShowCFB)(p_void Context);
+} RSP_CALLBACKS;
+
+/*
+ * bits of DPC_STATUS_REG as read, and as written to change them
+ *
+ * DPC_CLOCK_REG, DPC_BUFBUSY_REG, DPC_PIPEBUSY_REG and DPC_TMEM_REG are 24-bit
+ * counters of RDP clocks:  total, command buffer busy, pipeline busy and TMEM
+ * loading.  Writing a DPC_CLR_*_CTR bit to DPC_STATUS_REG resets a counter.
+ */
+#define DPC_STATUS_XBUS_DMEM_DMA        0x00000001UL
+#define DPC_STATUS_FREEZE               0x00000002UL
+#define DPC_STATUS_FLUSH                0x00000004UL
+#define DPC_STATUS_START_GCLK           0x00000008UL
+#define DPC_STATUS_TMEM_BUSY            0x00000010UL
+#define DPC_STATUS_PIPE_BUSY            0x00000020UL
+#define DPC_STATUS_CMD_BUSY             0x00000040UL
+#define DPC_STATUS_CBUF_READY           0x00000080UL
+#define DPC_STATUS_DMA_BUSY             0x00000100UL
+#define DPC_STATUS_END_VALID            0x00000200UL
+#define DPC_STATUS_START_VALID          0x00000400UL
+
+#define DPC_CLR_XBUS_DMEM_DMA           0x00000001UL
+#define DPC_SET_XBUS_DMEM_DMA           0x00000002UL
+#define DPC_CLR_FREEZE                  0x00000004UL
+#define DPC_SET_FREEZE                  0x00000008UL
+#define DPC_CLR_FLUSH                   0x00000010UL
+#define DPC_SET_FLUSH                   0x00000020UL
+#define DPC_CLR_TMEM_CTR                0x00000040UL
+#define DPC_CLR_PIPE_CTR                0x00000080UL
+#define DPC_CLR_CMD_CTR                 0x00000100UL
+#define DPC_CLR_CLOCK_CTR               0x00000200UL
+
+#define DPC_COUNTER_MASK                0x00FFFFFFUL
+#define DPC_COUNTER_ADD(reg, clocks)    \
+    ((reg) = ((reg) + (clocks)) & DPC_COUNTER_MASK)
+
+/*
+ * the write count of the page of RDRAM at `address', from the counters
+ * passed to SetRdramWriteCounters
+ */
+#define RDRAM_PAGE_WRITES(pages, shift, address) \
+    ((pages)[(uint32_t)(address) >> (shift)])
+
 typedef struct {
     /* menu */
     /* Items should have an ID between 5001 and 5100. */
@@ -142,6 +323,48 @@ typedef struct {
     p_func Enter_Memory_Window;
 } DEBUG_INFO;
 
+/*
+ * a process-wide cache of read-only data, shared by every plugin instance
+ *
+ * Entries are keyed by the kind of data and a 128-bit hash of the content
+ * they were derived from (e.g., the IMEM words of a recompiled block, or the
+ * TMEM and tile descriptor behind a decoded texture), so that any number of
+ * instances running the same ROM look up the same entry instead of each
+ * building its own.  The emulator implements these functions; Lookup is
+ * expected to be lock-free, and all of them may be called concurrently from
+ * any instance on any thread.
+ *
+ * Lookup and Insert both return a pointer to the first byte of an entry's
+ * data, holding one more reference to the entry, or NULL; Lookup also stores
+ * the data's size in bytes through `Size'.  Insert copies the data, and if an
+ * equal key was inserted first by another instance, returns that entry's data
+ * instead.  The data is never written to, and stays valid until the reference
+ * is given back by passing the same pointer to Release.
+ *
+ * An entry whose last reference is released stays in the cache, so that an
+ * instance started later can still find it; the emulator evicts only such
+ * unreferenced entries, and only when it needs the memory.  Lookup may always
+ * return NULL, in which case the plugin builds and inserts the data itself.
+ *
+ * CACHE_RSP_BLOCK data is copied into memory which is readable and executable
+ * (but not writable) by the time Insert returns.  Because every instance runs
+ * the same copy, the code must be position-independent and must not embed the
+ * address of anything belonging to one instance, such as its registers, its
+ * RSP_INFO or the memory that structure points to.  It reaches such state only
+ * through a pointer the plugin passes in each time it runs the block.
+ */
+#define CACHE_RSP_BLOCK             1 /* recompiled RSP code */
+#define CACHE_TEXTURE               2 /* decoded texture */
+
+typedef struct {
+    p_void (*Lookup)(
+        int Kind, uint64_t HashHigh, uint64_t HashLow, size_t * Size);
+    p_void (*Insert)(
+        int Kind, uint64_t HashHigh, uint64_t HashLow,
+        const void * Data, size_t Size);
+    void (*Release)(const void * Data);
+} CACHE_INFO;
+
 /******************************************************************************
 * name     :  CloseDLL
 * optional :  no
@@ -151,6 +374,33 @@ typedef struct {
 *******************************************************************************/
 EXPORT void CALL CloseDLL(void);
 
+/******************************************************************************
+* name     :  CreateRSP
+* optional :  yes
+* call time:  in place of InitiateRSP, once for each emulated console that is
+*             to run in this process
+* input    :  Rsp_Info  :  a RSP_INFO structure for this console's RCP memory
+*                          map, copied into the new instance
+*             Callbacks :  a RSP_CALLBACKS structure for this console, copied
+*                          into the new instance and used in place of the
+*                          callbacks in Rsp_Info
+*             CycleCount:  this console's cycle counter, as for InitiateRSP
+* output   :  a handle to the new instance, or NULL if it could not be created
+* notes    :  The handle is passed first to the `Ex' variant of every other
+*             per-instance export (see below), for as long as it is alive.
+*******************************************************************************/
+EXPORT RSP_CONTEXT CALL CreateRSP(
+    RSP_INFO * Rsp_Info, RSP_CALLBACKS * Callbacks, pu32 CycleCount);
+
+/******************************************************************************
+* name     :  DestroyRSP
+* optional :  yes (required if CreateRSP is exported)
+* call time:  when the emulated console owning the instance is shut down
+* input    :  a handle returned by CreateRSP
+* output   :  none
+*******************************************************************************/
+EXPORT void CALL DestroyRSP(RSP_CONTEXT Context);
+
 /******************************************************************************
 * name     :  DllAbout
 * optional :  yes
@@ -191,6 +441,33 @@ EXPORT void CALL DllTest(p_void hParent);
 *******************************************************************************/
 EXPORT u32 CALL DoRspCycles(u32 Cycles);
 
+/******************************************************************************
+* name     :  GetConfigValue
+* optional :  yes
+* call time:  whenever the emulator wants to read a plugin setting, including
+*             on systems where there is no window to pass to DllConfig
+* input    :  Key   :  name of the setting, such as one of the CONFIG_* keys
+*             Value :  buffer to receive the setting as a terminated string,
+*                      or NULL if Length is zero
+*             Length:  size of the Value buffer in bytes, terminator included
+* output   :  CONFIG_UNKNOWN_KEY if the key is not known, else the length of
+*             the whole value, not counting the terminator
+* notes    :  As with snprintf, at most Length - 1 characters are copied, and
+*             a result not less than Length means the value was truncated;
+*             calling with a Length of zero just asks for the size needed.
+*******************************************************************************/
+EXPORT int CALL GetConfigValue(const char * Key, char * Value, size_t Length);
+
+/******************************************************************************
+* name     :  GetDllCapabilities
+* optional :  yes
+* call time:  after GetDllInfo, when the emulator decides which optional fast
+*             paths to enable for the plugin
+* input    :  a pointer to a PLUGIN_CAPABILITIES structure to be filled in
+* output   :  none
+*******************************************************************************/
+EXPORT void CALL GetDllCapabilities(PLUGIN_CAPABILITIES * Capabilities);
+
 /******************************************************************************
 * name     :  GetDllInfo
 * optional :  no
@@ -210,6 +487,34 @@ EXPORT void CALL GetDllInfo(PLUGIN_INFO * PluginInfo);
 *******************************************************************************/
 EXPORT void CALL GetRspDebugInfo(RSPDEBUG_INFO * RSPDebugInfo);
 
+/******************************************************************************
+* name     :  ImemChanged
+* optional :  yes
+* call time:  when the emulator itself has written to IMEM, through either a
+*             CPU store to the SP memory map or an SP DMA it performed
+* input    :  Address:  offset into IMEM of the first byte written
+*             Length :  number of bytes written, starting at Address
+* output   :  none
+* notes    :  This lets a plugin which predecodes IMEM (see PredecodedCPU)
+*             refresh only the affected instructions before the next call to
+*             DoRspCycles, rather than re-decoding every step.  Writes made by
+*             the RSP itself, by its own DMA or by SW into IMEM, are already
+*             known to the plugin and are not reported.
+*******************************************************************************/
+EXPORT void CALL ImemChanged(u32 Address, u32 Length);
+
+/******************************************************************************
+* name     :  InitiateCache
+* optional :  yes
+* call time:  after plugin load and before InitiateRSP, when the emulator offers
+*             a cache shared by every plugin instance in the process
+* input    :  a CACHE_INFO structure of functions implemented by the emulator
+* output   :  none
+* notes    :  Without this call, or if any member is NULL, the plugin keeps
+*             private caches per instance as before.
+*******************************************************************************/
+EXPORT void CALL InitiateCache(CACHE_INFO Cache_Info);
+
 /******************************************************************************
 * name     :  InitiateRSP
 * optional :  no
@@ -231,6 +536,20 @@ EXPORT void CALL InitiateRSP(RSP_INFO Rsp_Info, pu32 CycleCount);
 *******************************************************************************/
 EXPORT void CALL InitiateRSPDebugger(DEBUG_INFO DebugInfo);
 
+/******************************************************************************
+* name     :  LoadConfigFile
+* optional :  yes
+* call time:  at any time before RomOpen, and again before later calls to
+*             RomOpen whenever the settings are to be reloaded
+* input    :  FileName:  path to an INI file of `key = value' lines, optionally
+*                        under `[section]' headers, or a TOML file of the same
+*                        flat form; each pair is applied as by SetConfigValue
+* output   :  nonzero if the file was read, zero if it could not be
+* notes    :  Settings which cannot change while a ROM is open take effect
+*             at the next RomOpen.
+*******************************************************************************/
+EXPORT int CALL LoadConfigFile(const char * FileName);
+
 /******************************************************************************
 * name     :  RomClosed
 * optional :  no
@@ -240,6 +559,38 @@ EXPORT void CALL InitiateRSPDebugger(DEBUG_INFO DebugInfo);
 *******************************************************************************/
 EXPORT void CALL RomClosed(void);
 
+/******************************************************************************
+* name     :  SetConfigValue
+* optional :  yes
+* call time:  whenever the emulator wants to change a plugin setting, including
+*             on systems where there is no window to pass to DllConfig
+* input    :  Key  :  name of the setting, such as one of the CONFIG_* keys
+*             Value:  the new setting as a terminated string
+* output   :  nonzero if the key is known and the value was accepted, else zero
+* notes    :  Settings which cannot change while a ROM is open take effect
+*             at the next RomOpen.
+*******************************************************************************/
+EXPORT int CALL SetConfigValue(const char * Key, const char * Value);
+
+/******************************************************************************
+* name     :  SetRdramWriteCounters
+* optional :  yes (see the notes)
+* call time:  after InitiateRSP and before RomOpen, when the emulator offers
+*             to count the writes to each page of RDRAM
+* input    :  Pages    :  one write counter per page of RDRAM, owned by the
+*                         emulator and valid until after RomClosed, or NULL
+*                         to stop
+*             PageShift:  log2 of the page size in bytes (e.g., 12 for 4 KiB)
+* output   :  none
+* notes    :  The plugin increments the counter of each page it writes, with
+*             RDRAM_PAGE_WRITES (wrapping around), for every SP DMA it
+*             performs from DMEM or IMEM into RDRAM, before the call making the
+*             write returns.  Without this export, the emulator cannot offer
+*             write counters to the graphics plugin (see SetRdramWriteCounters
+*             in the graphics plugin specifications).
+*******************************************************************************/
+EXPORT void CALL SetRdramWriteCounters(uint32_t * Pages, uint32_t PageShift);
+
 /*
  * required?? in version #1.2 of the RSP plugin spec
  * Have not tested a #1.2 implementation yet so shouldn't document them yet.
@@ -254,6 +605,23 @@ EXPORT void CALL EnableDebugging(int Enabled);
 EXPORT void CALL PluginLoaded(void);
 #endif
 
+/*
+ * per-instance variants of the above exports, for plugins exporting CreateRSP
+ *
+ * Each takes the handle returned by CreateRSP, followed by the parameters of
+ * the export of the same name without the `Ex' suffix, and behaves the same
+ * but for that instance only.  Exports not listed here (e.g., DllConfig) are
+ * shared by every instance of the plugin in the process.
+ */
+EXPORT u32 CALL DoRspCyclesEx(RSP_CONTEXT Context, u32 Cycles);
+EXPORT void CALL ImemChangedEx(RSP_CONTEXT Context, u32 Address, u32 Length);
+EXPORT void CALL RomClosedEx(RSP_CONTEXT Context);
+#if (SPECS_VERSION >= 0x0102)
+EXPORT void CALL RomOpenEx(RSP_CONTEXT Context);
+#endif
+EXPORT void CALL SetRdramWriteCountersEx(
+    RSP_CONTEXT Context, uint32_t * Pages, uint32_t PageShift);
+
 /************ profiling **************/
 #define Default_ProfilingOn         0
 #define Default_IndvidualBlock      0
@@ -262,6 +630,7 @@ EXPORT void CALL PluginLoaded(void);
 
 #define InterpreterCPU      0
 #define RecompilerCPU       1
+#define PredecodedCPU       2 /* interpreter over predecoded IMEM handlers */
 
 #if defined(__cplusplus)
 }